@@ -53,7 +53,9 @@ struct FileFD {
 };
 
 struct MappedFile {
-    MappedFile(const std::filesystem::path &file_path) : fd_(file_path) {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
         // Determine the filesize (needed for mmap)
         struct stat sb;
         if (fstat(fd_.get(), &sb) == 1)
@@ -79,14 +81,12 @@ struct MappedFile {
         if (chunk_begin_ == begin_ + sz_)
             return {};
 
-        size_t chunk_sz = 64 * 1024 * 1024; // 64MB
-
         const char *end = nullptr;
         // prevent reading past the end of the file
-        if (chunk_begin_ + chunk_sz > begin_ + sz_) {
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
             end = begin_ + sz_;
         } else {
-            end = chunk_begin_ + chunk_sz;
+            end = chunk_begin_ + chunk_sz_;
             while (end != begin_ + sz_ && *end != '\n')
                 ++end;
             ++end;
@@ -100,6 +100,7 @@ struct MappedFile {
     FileFD fd_;
     MoveOnly<char *> begin_;
     MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
     const char *chunk_begin_;
     std::mutex mux_;
 };
@@ -306,10 +307,14 @@ void format_output(std::ostream &out,
 
 int main(int argc, char **argv) {
     size_t chunks = 1;
-    if (argc == 2) {
+    size_t chunk_mb = 64;
+    if (argc >= 2) {
         chunks = atol(argv[1]);
     }
-    MappedFile mfile("measurements.txt");
+    if (argc >= 3) {
+        chunk_mb = atol(argv[2]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
 
     auto db = process_parallel(mfile, chunks);
     format_output(std::cout, db);
@@ -0,0 +1,276 @@
+#include "aggregate.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <ranges>
+#include <span>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+// A more generic version that works on a wide range of inputs but isn't as fast
+Measurement parse_v2(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    const char *end = strchr(begin, ';');
+    result.name = {begin, end};
+    result.hash = std::hash<std::string_view>{}(result.name);
+    iter += end - begin + 1;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+template <typename Aggregate>
+void process_input(DB<Aggregate> &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+template <typename Aggregate>
+using Results = std::unordered_map<std::string, typename Aggregate::State>;
+
+template <typename Aggregate>
+Results<Aggregate> process_parallel(MappedFile &file, size_t chunks) {
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::vector<DB<Aggregate>> dbs(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input(dbs[idx], chunk);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+
+    // Merge the partial DBs
+    Results<Aggregate> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk.filled_) {
+            auto it = merged.find(db_chunk.keys_[idx]);
+            if (it == merged.end()) {
+                merged.insert_or_assign(db_chunk.keys_[idx],
+                                        db_chunk.values_[idx]);
+            } else {
+                Aggregate::merge(it->second, db_chunk.values_[idx]);
+            }
+        }
+    }
+    return merged;
+}
+
+template <typename Aggregate>
+void format_output(std::ostream &out, Results<Aggregate> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        out << std::exchange(delim, ", ") << name << "=";
+        Aggregate::format(out, db[name]);
+    }
+    out << "}\n";
+}
+
+template <typename Aggregate> void run(MappedFile &mfile, size_t chunks) {
+    auto db = process_parallel<Aggregate>(mfile, chunks);
+    format_output<Aggregate>(std::cout, db);
+}
+
+int main(int argc, char **argv) {
+    // Usage: 10_aggregate_policy [threads] [chunk_mb] [--aggregate=name]
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    std::string_view aggregate = "minmeanmax";
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--aggregate="))
+            aggregate = arg.substr(arg.find('=') + 1);
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    // Each policy is a separate instantiation of the whole engine, the
+    // runtime choice only happens once here.
+    if (aggregate == "minmeanmax")
+        run<MinMeanMax>(mfile, chunks);
+    else if (aggregate == "variance")
+        run<Variance>(mfile, chunks);
+    else if (aggregate == "welford")
+        run<Welford>(mfile, chunks);
+    else if (aggregate == "histogram")
+        run<Histogram<20>>(mfile, chunks);
+    else if (aggregate == "last")
+        run<LastValue>(mfile, chunks);
+    else {
+        std::cerr << "Unknown aggregate: " << aggregate << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,662 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+// The first 16 bytes of the name (zero padded) are stored inline, so names
+// up to 16 bytes are compared with two integer comparisons.
+struct Key {
+    uint64_t prefix[2];
+    const char *name;
+    uint32_t len;
+    uint32_t hash;
+};
+
+static uint32_t key_hash(uint64_t p0, uint64_t p1, uint32_t len) {
+    uint64_t h = (p0 ^ std::rotl(p1, 29) ^ len) * 0x9E3779B97F4A7C15;
+    return h >> 32;
+}
+
+// Mask for the first "bytes" bytes of a little endian word
+static uint64_t low_bytes(size_t bytes) {
+    return bytes >= 8 ? ~uint64_t{0} : (uint64_t{1} << (bytes * 8)) - 1;
+}
+
+static uint64_t load_word(const char *ptr) {
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+static Key make_key(std::string_view name) {
+    Key key{{0, 0}, name.data(), uint32_t(name.size()), 0};
+    memcpy(key.prefix, name.data(), std::min<size_t>(name.size(), 16));
+    key.hash = key_hash(key.prefix[0], key.prefix[1], key.len);
+    return key;
+}
+
+struct alignas(64) Slot {
+    Key key;
+    Record value;
+};
+
+// Open addressing table sized by the planner, the keys point into the
+// mapped file. Grows if the planner underestimated the number of stations.
+struct Table {
+    explicit Table(size_t capacity) : slots_(capacity), mask_(capacity - 1) {}
+
+    // ShortKey: the caller guarantees that the name is at most 16 bytes
+    template <bool ShortKey> void record(const Key &key, int16_t value) {
+        Slot &slot = lookup_slot<ShortKey>(key);
+
+        // If the slot is empty, we have a miss
+        if (slot.key.name == nullptr) {
+            slot.key = key;
+            slot.value = Record{1, value, value, value};
+            if (++filled_ * 2 > slots_.size())
+                grow();
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (value < slot.value.min)
+            slot.value.min = value;
+        else if (value > slot.value.max)
+            slot.value.max = value;
+        slot.value.sum += value;
+        ++slot.value.cnt;
+    }
+
+    template <bool ShortKey> Slot &lookup_slot(const Key &key) {
+        size_t idx = key.hash & mask_;
+
+        // While the slot is already occupied
+        while (slots_[idx].key.name != nullptr) {
+            // If it is the same name, we have a hit
+            if (same_key<ShortKey>(slots_[idx].key, key))
+                break;
+            // Otherwise we have a collision
+            idx = (idx + 1) & mask_;
+        }
+
+        // Either the first empty slot or a hit
+        return slots_[idx];
+    }
+
+    template <bool ShortKey>
+    static bool same_key(const Key &left, const Key &right) {
+        if (left.len != right.len || left.prefix[0] != right.prefix[0] ||
+            left.prefix[1] != right.prefix[1])
+            return false;
+        if constexpr (ShortKey)
+            return true;
+        else
+            return left.len <= 16 ||
+                   memcmp(left.name + 16, right.name + 16, left.len - 16) == 0;
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots_.size() * 2);
+        std::swap(old, slots_);
+        mask_ = slots_.size() - 1;
+        for (auto &slot : old) {
+            if (slot.key.name == nullptr)
+                continue;
+            size_t idx = slot.key.hash & mask_;
+            while (slots_[idx].key.name != nullptr)
+                idx = (idx + 1) & mask_;
+            slots_[idx] = slot;
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t filled_ = 0;
+};
+
+// Generic parsing, works for any line but is slow
+//
+// Accepts CRLF line endings, a missing newline at the end of the input, any
+// number of decimal digits (rounded to tenths) and skips empty or malformed
+// lines.
+
+static std::optional<int16_t> parse_decimal(std::string_view text) {
+    bool negative = false;
+    if (not text.empty() && (text.front() == '-' || text.front() == '+')) {
+        negative = text.front() == '-';
+        text.remove_prefix(1);
+    }
+    int32_t value = 0;
+    size_t digits = 0;
+    size_t decimals = 0;
+    bool dot = false;
+    bool round_up = false;
+    for (char c : text) {
+        if (c == '.' && not dot) {
+            dot = true;
+        } else if (c >= '0' && c <= '9') {
+            ++digits;
+            if (not dot) {
+                value = value * 10 + (c - '0');
+            } else if (decimals++ == 0) {
+                value = value * 10 + (c - '0');
+            } else if (decimals == 2) {
+                round_up = c >= '5';
+            }
+            if (value > INT16_MAX)
+                return std::nullopt;
+        } else {
+            return std::nullopt;
+        }
+    }
+    if (digits == 0)
+        return std::nullopt;
+    if (decimals == 0)
+        value *= 10;
+    value += round_up;
+    // The scaling and the rounding can still leave the range of int16_t
+    if (value > INT16_MAX)
+        return std::nullopt;
+    return negative ? -value : value;
+}
+
+struct Line {
+    std::string_view name;
+    std::optional<int16_t> value;
+    bool crlf;
+    const char *next;
+};
+
+static Line split_line(const char *iter, const char *end) {
+    auto nl = static_cast<const char *>(memchr(iter, '\n', end - iter));
+    const char *line_end = nl != nullptr ? nl : end;
+    Line result{{}, std::nullopt, false, nl != nullptr ? nl + 1 : end};
+
+    std::string_view line(iter, line_end);
+    if (line.ends_with('\r')) {
+        line.remove_suffix(1);
+        result.crlf = true;
+    }
+    auto semicolon = line.find(';');
+    if (semicolon == line.npos || semicolon == 0)
+        return result;
+    result.name = line.substr(0, semicolon);
+    result.value = parse_decimal(line.substr(semicolon + 1));
+    return result;
+}
+
+static const char *process_generic_line(Table &db, const char *iter,
+                                        const char *end) {
+    Line line = split_line(iter, end);
+    if (line.value)
+        db.record<false>(make_key(line.name), *line.value);
+    return line.next;
+}
+
+// Fast parsing, specialized for the traits detected by the planner
+//
+// Each line is validated as a side effect of parsing it: if the line doesn't
+// match the expected shape, nullptr is returned without touching the table
+// and the caller falls back to the generic parser for that line.
+
+static constexpr uint64_t ones = 0x0101010101010101;
+static constexpr uint64_t highs = 0x8080808080808080;
+
+// High bit set in every byte of "word" equal to "c" (exact up to the first)
+static uint64_t find_byte(uint64_t word, char c) {
+    uint64_t x = word ^ (ones * uint8_t(c));
+    return (x - ones) & ~x & highs;
+}
+
+// Decode a "-?d?d.d" value terminated by '\n' (or "\r\n") from 8 bytes,
+// based on the branchless decoding by Quan Anh Mai (merykitty)
+template <bool CRLF> static const char *parse_value(const char *ptr, int16_t &out) {
+    uint64_t word = load_word(ptr);
+    uint64_t dots = ~word & 0x10101000;
+    if (dots == 0)
+        return nullptr;
+    int dot_bit = std::countr_zero(dots);
+    int dot = dot_bit >> 3;
+    bool negative = ptr[0] == '-';
+    int int_digits = dot - negative;
+
+    auto digit = [](char c) { return unsigned(c - '0') < 10; };
+    // Non-short-circuiting, the checks are cheaper than the branches
+    bool valid = (ptr[dot] == '.') & digit(ptr[dot + 1]) &
+                 digit(ptr[negative]) &
+                 ((int_digits == 1) | ((int_digits == 2) & digit(ptr[dot - 1])));
+    if constexpr (CRLF)
+        valid &= (ptr[dot + 2] == '\r') & (ptr[dot + 3] == '\n');
+    else
+        valid &= ptr[dot + 2] == '\n';
+    if (not valid)
+        return nullptr;
+
+    int shift = 28 - dot_bit;
+    int64_t sign = (int64_t(~word) << 59) >> 63;
+    uint64_t design_mask = ~(sign & 0xFF);
+    uint64_t digits = ((word & design_mask) << shift) & 0x0F000F0F00;
+    uint64_t abs_value = ((digits * 0x640a0001) >> 32) & 0x3FF;
+    out = int16_t((abs_value ^ sign) - sign);
+    return ptr + dot + (CRLF ? 4 : 3);
+}
+
+template <bool ShortNames, bool CRLF>
+static const char *process_fast_line(Table &db, const char *iter) {
+    Key key;
+    key.name = iter;
+    bool short_key = false;
+
+    if constexpr (ShortNames) {
+        uint64_t w0 = load_word(iter);
+        uint64_t w1 = load_word(iter + 8);
+        uint64_t semi0 = find_byte(w0, ';');
+        uint64_t semi1 = find_byte(w1, ';');
+        if (semi0 != 0) {
+            uint64_t mask = (semi0 ^ (semi0 - 1)) >> 8;
+            if (mask == 0 || (find_byte(w0, '\n') & mask) != 0)
+                return nullptr;
+            key.prefix[0] = w0 & mask;
+            key.prefix[1] = 0;
+            key.len = std::countr_zero(semi0) >> 3;
+            short_key = true;
+        } else if (semi1 != 0) {
+            uint64_t mask = (semi1 ^ (semi1 - 1)) >> 8;
+            if ((find_byte(w0, '\n') | (find_byte(w1, '\n') & mask)) != 0)
+                return nullptr;
+            key.prefix[0] = w0;
+            key.prefix[1] = w1 & mask;
+            key.len = 8 + (std::countr_zero(semi1) >> 3);
+            short_key = true;
+        }
+    }
+
+    if (not short_key) {
+        // The names are at most 100 bytes
+        auto semicolon = static_cast<const char *>(memchr(iter, ';', 101));
+        if (semicolon == nullptr || semicolon == iter ||
+            memchr(iter, '\n', semicolon - iter) != nullptr)
+            return nullptr;
+        key.len = semicolon - iter;
+        key.prefix[0] = load_word(iter) & low_bytes(key.len);
+        key.prefix[1] =
+            key.len > 8 ? load_word(iter + 8) & low_bytes(key.len - 8) : 0;
+    }
+    int16_t value;
+    const char *next = parse_value<CRLF>(iter + key.len + 1, value);
+    if (next == nullptr)
+        return nullptr;
+
+    key.hash = key_hash(key.prefix[0], key.prefix[1], key.len);
+    if (ShortNames && short_key)
+        db.record<true>(key, value);
+    else
+        db.record<false>(key, value);
+    return next;
+}
+
+// The engines, processing one chunk of the input. The fast engines can read
+// up to 128 bytes past the current line, so the end of the file always goes
+// through the generic parser.
+
+struct GenericEngine {
+    static constexpr std::string_view name = "generic";
+
+    static void process(Table &db, std::span<const char> chunk,
+                        const char *) {
+        const char *iter = chunk.data();
+        const char *end = chunk.data() + chunk.size();
+        while (iter != end)
+            iter = process_generic_line(db, iter, end);
+    }
+};
+
+template <bool ShortNames, bool CRLF> struct FastEngine {
+    static constexpr std::string_view name =
+        ShortNames ? (CRLF ? "fast, short names, CRLF" : "fast, short names")
+                   : (CRLF ? "fast, CRLF" : "fast");
+
+    static void process(Table &db, std::span<const char> chunk,
+                        const char *file_end) {
+        const char *iter = chunk.data();
+        const char *end = chunk.data() + chunk.size();
+        const char *fast_end = file_end - std::min<size_t>(file_end - iter, 128);
+        while (iter != end) {
+            const char *next = nullptr;
+            if (iter < fast_end)
+                next = process_fast_line<ShortNames, CRLF>(db, iter);
+            if (next == nullptr)
+                next = process_generic_line(db, iter, end);
+            iter = next;
+        }
+    }
+};
+
+// The planner
+//
+// Parses a few evenly spread blocks of the input with the generic parser and
+// derives the traits of the input from them.
+
+struct Plan {
+    size_t lines = 0;
+    size_t irregular = 0;
+    size_t crlf = 0;
+    size_t max_name = 0;
+    bool ascii = true;
+    size_t distinct = 0;
+    size_t stations = 0;
+
+    bool generic = false;
+    bool short_names = false;
+    bool crlf_endings = false;
+    size_t table_capacity = 0;
+};
+
+static bool fixed_shape(std::string_view line) {
+    auto semicolon = line.find(';');
+    if (semicolon == line.npos || semicolon == 0)
+        return false;
+    auto value = line.substr(semicolon + 1);
+    if (value.starts_with('-'))
+        value.remove_prefix(1);
+    auto digit = [](char c) { return c >= '0' && c <= '9'; };
+    return (value.size() == 3 || value.size() == 4) && digit(value[0]) &&
+           digit(value[value.size() - 1]) &&
+           value[value.size() - 2] == '.' &&
+           (value.size() == 3 || digit(value[1]));
+}
+
+static Plan make_plan(std::span<const char> data) {
+    constexpr size_t blocks = 16;
+    constexpr size_t block_sz = 64 * 1024;
+
+    Plan plan;
+    std::unordered_map<std::string_view, size_t> seen;
+    const char *file_end = data.data() + data.size();
+    for (size_t b = 0; b < blocks; ++b) {
+        const char *iter = data.data() + data.size() / blocks * b;
+        const char *end = std::min(iter + block_sz, file_end);
+        // Start at the beginning of a line
+        if (b != 0) {
+            auto nl = static_cast<const char *>(memchr(iter, '\n', end - iter));
+            if (nl == nullptr)
+                continue;
+            iter = nl + 1;
+        }
+        while (iter < end) {
+            Line line = split_line(iter, file_end);
+            std::string_view text(iter, line.next - iter);
+            iter = line.next;
+            if (text.ends_with('\n'))
+                text.remove_suffix(1);
+            ++plan.lines;
+            plan.crlf += line.crlf;
+            if (line.crlf)
+                text.remove_suffix(1);
+            if (not fixed_shape(text)) {
+                ++plan.irregular;
+                continue;
+            }
+            plan.max_name = std::max(plan.max_name, line.name.size());
+            for (unsigned char c : line.name)
+                plan.ascii &= c < 0x80;
+            ++seen[line.name];
+        }
+    }
+
+    // Chao1 estimate of the number of distinct stations
+    size_t once = 0, twice = 0;
+    for (auto &[name, cnt] : seen) {
+        once += cnt == 1;
+        twice += cnt == 2;
+    }
+    plan.distinct = seen.size();
+    plan.stations = plan.distinct + (twice > 0 ? once * once / (2 * twice)
+                                               : once * (once - 1) / 2);
+
+    // Only inputs that are mostly irregular or mix line endings go to the
+    // generic engine, occasional bad lines fall back on their own.
+    plan.crlf_endings = plan.crlf * 100 > plan.lines * 99;
+    plan.generic = plan.lines == 0 || plan.irregular * 100 > plan.lines ||
+                   (plan.crlf * 100 > plan.lines && not plan.crlf_endings);
+    plan.short_names = plan.max_name <= 16;
+    plan.table_capacity =
+        std::bit_ceil(std::clamp<size_t>(plan.stations * 2, 1024, 1 << 18));
+    return plan;
+}
+
+template <typename Engine>
+std::unordered_map<std::string, Record>
+process_parallel(MappedFile &file, size_t chunks, const Plan &plan) {
+    const char *file_end = file.data().data() + file.data().size();
+
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::vector<Table> dbs(chunks, Table(plan.table_capacity));
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                Engine::process(dbs[idx], chunk, file_end);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+
+    // Merge the partial DBs
+    std::unordered_map<std::string, Record> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto &slot : db_chunk.slots_) {
+            if (slot.key.name == nullptr)
+                continue;
+            std::string name(slot.key.name, slot.key.len);
+            auto it = merged.find(name);
+            if (it == merged.end()) {
+                merged.insert_or_assign(std::move(name), slot.value);
+            } else {
+                it->second.cnt += slot.value.cnt;
+                it->second.sum += slot.value.sum;
+                it->second.max = std::max(it->second.max, slot.value.max);
+                it->second.min = std::min(it->second.min, slot.value.min);
+            }
+        }
+    }
+    return merged;
+}
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+template <typename Engine>
+void run(MappedFile &mfile, size_t chunks, const Plan &plan, bool verbose) {
+    if (verbose)
+        std::cerr << "engine: " << Engine::name << "\n";
+    auto db = process_parallel<Engine>(mfile, chunks, plan);
+    format_output(std::cout, db);
+}
+
+int main(int argc, char **argv) {
+    // Usage: 11_planner [threads] [chunk_mb] [--plan] [--generic]
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    bool verbose = false;
+    bool force_generic = false;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--plan")
+            verbose = true;
+        else if (arg == "--generic")
+            force_generic = true;
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    Plan plan = make_plan(mfile.data());
+    if (verbose)
+        std::cerr << "sampled lines: " << plan.lines
+                  << ", irregular: " << plan.irregular
+                  << ", CRLF: " << plan.crlf
+                  << ", max name: " << plan.max_name
+                  << ", ASCII names: " << plan.ascii
+                  << ", distinct: " << plan.distinct
+                  << ", estimated stations: " << plan.stations
+                  << ", table: " << plan.table_capacity << "\n";
+
+    if (plan.generic || force_generic)
+        run<GenericEngine>(mfile, chunks, plan, verbose);
+    else if (plan.short_names && plan.crlf_endings)
+        run<FastEngine<true, true>>(mfile, chunks, plan, verbose);
+    else if (plan.short_names)
+        run<FastEngine<true, false>>(mfile, chunks, plan, verbose);
+    else if (plan.crlf_endings)
+        run<FastEngine<false, true>>(mfile, chunks, plan, verbose);
+    else
+        run<FastEngine<false, false>>(mfile, chunks, plan, verbose);
+}
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <immintrin.h>
+#include <iostream>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+// The first 16 bytes of the name (zero padded) are stored inline, the name
+// itself points into the mapped file.
+struct Key {
+    uint64_t prefix[2];
+    const char *name;
+    uint32_t len;
+    uint32_t hash;
+};
+
+struct alignas(64) Slot {
+    Key key;
+    Record value;
+};
+
+// Open addressing table, the lookups and updates are in cpu_kernels.inc
+struct Table {
+    explicit Table(size_t capacity = 1 << 14)
+        : slots_(capacity), mask_(capacity - 1) {}
+
+    void inserted() {
+        if (++filled_ * 2 > slots_.size())
+            grow();
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots_.size() * 2);
+        std::swap(old, slots_);
+        mask_ = slots_.size() - 1;
+        for (auto &slot : old) {
+            if (slot.key.name == nullptr)
+                continue;
+            size_t idx = slot.key.hash & mask_;
+            while (slots_[idx].key.name != nullptr)
+                idx = (idx + 1) & mask_;
+            slots_[idx] = slot;
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t filled_ = 0;
+};
+
+inline uint32_t key_hash(uint64_t p0, uint64_t p1, uint32_t len) {
+    uint64_t h = (p0 ^ std::rotl(p1, 29) ^ len) * 0x9E3779B97F4A7C15;
+    return h >> 32;
+}
+
+// Mask for the first "bytes" bytes of a little endian word
+inline uint64_t low_bytes(size_t bytes) {
+    return bytes >= 8 ? ~uint64_t{0} : (uint64_t{1} << (bytes * 8)) - 1;
+}
+
+inline uint64_t load_word(const char *ptr) {
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+// Same as make_key in the kernels, but never reads past the name
+inline Key make_key_safe(const char *name, size_t len) {
+    Key key{{0, 0}, name, uint32_t(len), 0};
+    memcpy(key.prefix, name, std::min<size_t>(len, 16));
+    key.hash = key_hash(key.prefix[0], key.prefix[1], key.len);
+    return key;
+}
+
+namespace baseline {
+#define KERNEL_LEVEL 0
+#define KERNEL_TARGET
+#include "cpu_kernels.inc"
+#undef KERNEL_TARGET
+#undef KERNEL_LEVEL
+} // namespace baseline
+
+namespace avx2 {
+#define KERNEL_LEVEL 1
+#define KERNEL_TARGET [[gnu::target("avx2,bmi,bmi2,popcnt")]]
+#include "cpu_kernels.inc"
+#undef KERNEL_TARGET
+#undef KERNEL_LEVEL
+} // namespace avx2
+
+namespace avx512 {
+#define KERNEL_LEVEL 2
+#define KERNEL_TARGET                                                          \
+    [[gnu::target("avx512f,avx512bw,avx512vl,avx2,bmi,bmi2,popcnt")]]
+#include "cpu_kernels.inc"
+#undef KERNEL_TARGET
+#undef KERNEL_LEVEL
+} // namespace avx512
+
+struct Kernels {
+    std::string_view name;
+    void (*process_input)(Table &, std::span<const char>, const char *);
+    void (*merge)(Table &, const Table &);
+};
+
+static constexpr Kernels kernel_levels[] = {
+    {"baseline", baseline::process_input, baseline::merge},
+    {"avx2", avx2::process_input, avx2::merge},
+    {"avx512", avx512::process_input, avx512::merge},
+};
+
+static bool supported(const Kernels &level) {
+    __builtin_cpu_init();
+    if (level.name == "avx512")
+        return __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512bw") &&
+               __builtin_cpu_supports("avx512vl") && supported(kernel_levels[1]);
+    if (level.name == "avx2")
+        return __builtin_cpu_supports("avx2") &&
+               __builtin_cpu_supports("bmi") &&
+               __builtin_cpu_supports("bmi2") &&
+               __builtin_cpu_supports("popcnt");
+    return true;
+}
+
+// Picked once at startup: the best level the CPU supports, or the level
+// forced with --isa= or the ONEBRC_ISA environment variable.
+static const Kernels &select_kernels(std::string_view forced) {
+    if (forced.empty()) {
+        for (auto &level : kernel_levels | std::views::reverse)
+            if (supported(level))
+                return level;
+    }
+    for (auto &level : kernel_levels) {
+        if (level.name != forced)
+            continue;
+        if (not supported(level))
+            throw std::runtime_error("This CPU doesn't support " +
+                                     std::string(forced));
+        return level;
+    }
+    throw std::runtime_error("Unknown instruction set level " +
+                             std::string(forced));
+}
+
+std::unordered_map<std::string, Record>
+process_parallel(MappedFile &file, size_t chunks, const Kernels &kernels) {
+    const char *file_end = file.data().data() + file.data().size();
+
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::vector<Table> dbs(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                kernels.process_input(dbs[idx], chunk, file_end);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+
+    // Merge the partial DBs
+    for (size_t i = 1; i < dbs.size(); ++i)
+        kernels.merge(dbs[0], dbs[i]);
+
+    std::unordered_map<std::string, Record> merged;
+    for (auto &slot : dbs[0].slots_)
+        if (slot.key.name != nullptr)
+            merged.emplace(std::string(slot.key.name, slot.key.len),
+                           slot.value);
+    return merged;
+}
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+int main(int argc, char **argv) try {
+    // Usage: 12_cpu_dispatch [threads] [chunk_mb] [--isa=baseline|avx2|avx512]
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    const char *env_isa = std::getenv("ONEBRC_ISA");
+    std::string_view isa = env_isa != nullptr ? env_isa : "";
+    bool verbose = false;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--isa="))
+            isa = arg.substr(arg.find('=') + 1);
+        else if (arg == "--verbose")
+            verbose = true;
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    const Kernels &kernels = select_kernels(isa);
+    if (verbose)
+        std::cerr << "kernels: " << kernels.name << "\n";
+
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+    auto db = process_parallel(mfile, chunks, kernels);
+    format_output(std::cout, db);
+} catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <immintrin.h>
+#include <iostream>
+#include <ranges>
+#include <span>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+// The first 16 bytes of the name (zero padded) are stored inline, the name
+// itself points into the mapped file.
+struct Key {
+    uint64_t prefix[2];
+    const char *name;
+    uint32_t len;
+    uint32_t hash;
+};
+
+struct alignas(64) Slot {
+    Key key;
+    Record value;
+};
+
+static uint32_t key_hash(uint64_t p0, uint64_t p1, uint32_t len) {
+    uint64_t h = (p0 ^ std::rotl(p1, 29) ^ len) * 0x9E3779B97F4A7C15;
+    return h >> 32;
+}
+
+// Mask for the first "bytes" bytes of a little endian word
+static uint64_t low_bytes(size_t bytes) {
+    return bytes >= 8 ? ~uint64_t{0} : (uint64_t{1} << (bytes * 8)) - 1;
+}
+
+static uint64_t load_word(const char *ptr) {
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+// A batch of parsed lines in structure of arrays form
+static constexpr size_t batch_size = 16;
+
+struct Batch {
+    const char *name[batch_size];
+    uint32_t len[batch_size];
+    uint64_t prefix0[batch_size];
+    uint64_t prefix1[batch_size];
+    uint32_t hash[batch_size];
+    int16_t value[batch_size];
+};
+
+// Open addressing table, grows at 50% load
+struct Table {
+    explicit Table(size_t capacity = 1 << 14)
+        : slots_(capacity), mask_(capacity - 1) {}
+
+    void record_batch(const Batch &batch, size_t lines) {
+        for (size_t i = 0; i < lines; ++i) {
+            Key key{{batch.prefix0[i], batch.prefix1[i]},
+                    batch.name[i],
+                    batch.len[i],
+                    batch.hash[i]};
+            record(key, batch.value[i]);
+        }
+    }
+
+    void record(const Key &key, int16_t value) {
+        Slot &slot = lookup_slot(key);
+
+        // If the slot is empty, we have a miss
+        if (slot.key.name == nullptr) {
+            slot.key = key;
+            slot.value = Record{1, value, value, value};
+            if (++filled_ * 2 > slots_.size())
+                grow();
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (value < slot.value.min)
+            slot.value.min = value;
+        else if (value > slot.value.max)
+            slot.value.max = value;
+        slot.value.sum += value;
+        ++slot.value.cnt;
+    }
+
+    Slot &lookup_slot(const Key &key) {
+        size_t idx = key.hash & mask_;
+
+        // While the slot is already occupied
+        while (slots_[idx].key.name != nullptr) {
+            // If it is the same name, we have a hit
+            if (same_key(slots_[idx].key, key))
+                break;
+            // Otherwise we have a collision
+            idx = (idx + 1) & mask_;
+        }
+
+        // Either the first empty slot or a hit
+        return slots_[idx];
+    }
+
+    static bool same_key(const Key &left, const Key &right) {
+        if (left.len != right.len || left.prefix[0] != right.prefix[0] ||
+            left.prefix[1] != right.prefix[1])
+            return false;
+        return left.len <= 16 ||
+               memcmp(left.name + 16, right.name + 16, left.len - 16) == 0;
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots_.size() * 2);
+        std::swap(old, slots_);
+        mask_ = slots_.size() - 1;
+        for (auto &slot : old) {
+            if (slot.key.name == nullptr)
+                continue;
+            size_t idx = slot.key.hash & mask_;
+            while (slots_[idx].key.name != nullptr)
+                idx = (idx + 1) & mask_;
+            slots_[idx] = slot;
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t filled_ = 0;
+};
+
+// Bitmasks of the ';' and '\n' bytes in a 64 byte block
+struct BlockMasks {
+    uint64_t semicolons;
+    uint64_t newlines;
+};
+
+static BlockMasks scan_block(const char *ptr) {
+#if defined(__AVX512BW__)
+    __m512i block = _mm512_loadu_si512(ptr);
+    return {_mm512_cmpeq_epi8_mask(block, _mm512_set1_epi8(';')),
+            _mm512_cmpeq_epi8_mask(block, _mm512_set1_epi8('\n'))};
+#elif defined(__AVX2__)
+    BlockMasks result{0, 0};
+    for (size_t i = 0; i < 2; ++i) {
+        __m256i block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(ptr + i * 32));
+        uint32_t semi = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(block, _mm256_set1_epi8(';')));
+        uint32_t nl = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+        result.semicolons |= uint64_t{semi} << (i * 32);
+        result.newlines |= uint64_t{nl} << (i * 32);
+    }
+    return result;
+#else
+    // SSE2 is part of the x86-64 baseline
+    BlockMasks result{0, 0};
+    for (size_t i = 0; i < 4; ++i) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + i * 16));
+        uint32_t semi =
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(';')));
+        uint32_t nl =
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+        result.semicolons |= uint64_t{semi} << (i * 16);
+        result.newlines |= uint64_t{nl} << (i * 16);
+    }
+    return result;
+#endif
+}
+
+// Decode "-?d?d.d\n" from a single 8 byte load (merykitty's SWAR decoding)
+static int16_t decode_value(uint64_t word) {
+    int dot_bit = std::countr_zero(~word & 0x10101000);
+    int shift = 28 - dot_bit;
+    int64_t sign = (int64_t(~word) << 59) >> 63;
+    uint64_t design_mask = ~(sign & 0xFF);
+    uint64_t digits = ((word & design_mask) << shift) & 0x0F000F0F00;
+    uint64_t abs_value = ((digits * 0x640a0001) >> 32) & 0x3FF;
+    return int16_t((abs_value ^ sign) - sign);
+}
+
+// Load 8 bytes, zero filled past the end of the file
+static uint64_t load_word_safe(const char *ptr, const char *file_end) {
+    if (ptr + 8 <= file_end)
+        return load_word(ptr);
+    uint64_t word = 0;
+    memcpy(&word, ptr, file_end - ptr);
+    return word;
+}
+
+// Decode a batch of lines, given the offsets of their ';' and '\n'. Every
+// step is a loop over the independent lanes, there is no dependency between
+// the lines of the batch.
+static void decode_batch(Batch &batch, const char *base, size_t line_begin,
+                         const uint64_t *semicolons, const uint64_t *newlines,
+                         size_t lines, const char *file_end) {
+    for (size_t i = 0; i < lines; ++i) {
+        size_t begin = i == 0 ? line_begin : newlines[i - 1] + 1;
+        batch.name[i] = base + begin;
+        batch.len[i] = semicolons[i] - begin;
+    }
+    for (size_t i = 0; i < lines; ++i) {
+        const char *name = batch.name[i];
+        uint32_t len = batch.len[i];
+        batch.prefix0[i] = load_word_safe(name, file_end) & low_bytes(len);
+        batch.prefix1[i] = len > 8 ? load_word_safe(name + 8, file_end) &
+                                         low_bytes(len - 8)
+                                   : 0;
+    }
+    for (size_t i = 0; i < lines; ++i)
+        batch.hash[i] =
+            key_hash(batch.prefix0[i], batch.prefix1[i], batch.len[i]);
+    for (size_t i = 0; i < lines; ++i)
+        batch.value[i] = decode_value(
+            load_word_safe(base + semicolons[i] + 1, file_end));
+}
+
+void process_input(Table &db, std::span<const char> data,
+                   const char *file_end) {
+    const char *base = data.data();
+    size_t size = data.size();
+
+    // Offsets of the separators that are not yet part of a decoded batch, a
+    // block adds at most 64 of each
+    uint64_t semicolons[batch_size + 64];
+    uint64_t newlines[batch_size + 64];
+    size_t semi_cnt = 0;
+    size_t nl_cnt = 0;
+    size_t line_begin = 0;
+    Batch batch;
+
+    for (size_t offset = 0; offset < size; offset += 64) {
+        BlockMasks masks;
+        if (base + offset + 64 <= file_end) {
+            masks = scan_block(base + offset);
+        } else {
+            // The last block of the file, scan a zero padded copy
+            alignas(64) char tail[64] = {};
+            memcpy(tail, base + offset, file_end - (base + offset));
+            masks = scan_block(tail);
+        }
+        // Ignore anything past the end of the chunk
+        if (size - offset < 64) {
+            uint64_t valid = (uint64_t{1} << (size - offset)) - 1;
+            masks.semicolons &= valid;
+            masks.newlines &= valid;
+        }
+
+        for (uint64_t m = masks.semicolons; m != 0; m &= m - 1)
+            semicolons[semi_cnt++] = offset + std::countr_zero(m);
+        for (uint64_t m = masks.newlines; m != 0; m &= m - 1)
+            newlines[nl_cnt++] = offset + std::countr_zero(m);
+
+        // Decode and record full batches of complete lines
+        size_t done = 0;
+        while (nl_cnt - done >= batch_size) {
+            decode_batch(batch, base, line_begin, semicolons + done,
+                         newlines + done, batch_size, file_end);
+            db.record_batch(batch, batch_size);
+            line_begin = newlines[done + batch_size - 1] + 1;
+            done += batch_size;
+        }
+        if (done != 0) {
+            std::copy(semicolons + done, semicolons + semi_cnt, semicolons);
+            std::copy(newlines + done, newlines + nl_cnt, newlines);
+            semi_cnt -= done;
+            nl_cnt -= done;
+        }
+    }
+
+    // The remaining lines, the last one might be missing the newline
+    if (semi_cnt > nl_cnt)
+        newlines[nl_cnt++] = size;
+    decode_batch(batch, base, line_begin, semicolons, newlines, nl_cnt,
+                 file_end);
+    db.record_batch(batch, nl_cnt);
+}
+
+std::unordered_map<std::string, Record> process_parallel(MappedFile &file,
+                                                         size_t chunks) {
+    const char *file_end = file.data().data() + file.data().size();
+
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::vector<Table> dbs(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input(dbs[idx], chunk, file_end);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+
+    // Merge the partial DBs
+    std::unordered_map<std::string, Record> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto &slot : db_chunk.slots_) {
+            if (slot.key.name == nullptr)
+                continue;
+            std::string name(slot.key.name, slot.key.len);
+            auto it = merged.find(name);
+            if (it == merged.end()) {
+                merged.insert_or_assign(std::move(name), slot.value);
+            } else {
+                it->second.cnt += slot.value.cnt;
+                it->second.sum += slot.value.sum;
+                it->second.max = std::max(it->second.max, slot.value.max);
+                it->second.min = std::min(it->second.min, slot.value.min);
+            }
+        }
+    }
+    return merged;
+}
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+int main(int argc, char **argv) {
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    if (argc >= 2) {
+        chunks = atol(argv[1]);
+    }
+    if (argc >= 3) {
+        chunk_mb = atol(argv[2]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    auto db = process_parallel(mfile, chunks);
+    format_output(std::cout, db);
+}
\ No newline at end of file
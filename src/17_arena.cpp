@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Allocation counters: every heap allocation of the process goes through
+// these operators. The per-thread count is used to check that the parse
+// loops don't allocate at all.
+static std::atomic<uint64_t> heap_allocations = 0;
+static std::atomic<uint64_t> heap_bytes = 0;
+static thread_local uint64_t thread_heap_allocations = 0;
+
+static void count_allocation(size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    heap_bytes.fetch_add(size, std::memory_order_relaxed);
+    ++thread_heap_allocations;
+}
+
+void *operator new(size_t size) {
+    count_allocation(size);
+    if (void *ptr = std::malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t align) {
+    count_allocation(size);
+    size_t alignment = static_cast<size_t>(align);
+    size = (size + alignment - 1) / alignment * alignment;
+    if (void *ptr = std::aligned_alloc(alignment, size != 0 ? size : alignment))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+// A monotonic memory resource over a single anonymous mapping. Allocation is
+// a lock-free bump of the offset, deallocation is a no-op and the whole arena
+// is released with one munmap. The mapping is only reserved, pages are
+// populated as they are touched. Allocations that don't fit anymore fall back
+// to the heap.
+class Arena : public std::pmr::memory_resource {
+  public:
+    enum class Pages { Normal, Transparent, Huge };
+
+    Arena(size_t capacity, Pages pages) : pages_(pages) {
+        if (pages_ == Pages::Huge) {
+            // Explicit huge pages need a reserved pool (vm.nr_hugepages),
+            // fall back to transparent huge pages if there isn't one.
+            capacity_ = (capacity + huge_page - 1) / huge_page * huge_page;
+            begin_ = static_cast<char *>(mmap(
+                nullptr, capacity_, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0));
+            if (begin_ == MAP_FAILED)
+                pages_ = Pages::Transparent;
+        }
+        if (pages_ != Pages::Huge) {
+            capacity_ = capacity;
+            begin_ = static_cast<char *>(mmap(
+                nullptr, capacity_, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+            if (begin_ == MAP_FAILED)
+                throw std::system_error(errno, std::system_category(),
+                                        "Failed to map the arena");
+        }
+        if (pages_ == Pages::Transparent)
+            madvise(begin_, capacity_, MADV_HUGEPAGE);
+    }
+
+    ~Arena() { munmap(begin_, capacity_); }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    Pages pages() const { return pages_; }
+    size_t capacity() const { return capacity_; }
+    size_t used() const { return std::min(next_.load(), capacity_); }
+    uint64_t allocations() const { return allocations_.load(); }
+    uint64_t overflows() const { return overflows_.load(); }
+
+  private:
+    static constexpr size_t huge_page = 2 * 1024 * 1024;
+
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        size_t offset = next_.load(std::memory_order_relaxed);
+        size_t aligned;
+        do {
+            aligned = (offset + alignment - 1) / alignment * alignment;
+        } while (not next_.compare_exchange_weak(offset, aligned + bytes,
+                                                 std::memory_order_relaxed));
+        if (aligned + bytes > capacity_) {
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        return begin_ + aligned;
+    }
+
+    void do_deallocate(void *ptr, size_t bytes, size_t alignment) override {
+        char *p = static_cast<char *>(ptr);
+        if (p < begin_ || p >= begin_ + capacity_)
+            std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    Pages pages_;
+    char *begin_;
+    size_t capacity_;
+    std::atomic<size_t> next_ = 0;
+    std::atomic<uint64_t> allocations_ = 0;
+    std::atomic<uint64_t> overflows_ = 0;
+};
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+// The table from 09_dynamic_chunks.cpp, allocator-aware so that the arrays
+// and the names are allocated from the arena
+struct DB {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit DB(allocator_type alloc)
+        : keys_(UINT16_MAX + 1, alloc), values_(UINT16_MAX + 1, alloc),
+          filled_(alloc) {
+        filled_.reserve(UINT16_MAX + 1);
+    }
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::pmr::vector<std::pmr::string> keys_;
+    // Values
+    std::pmr::vector<Record> values_;
+    // Record of used indices (needed for output)
+    std::pmr::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+using Result = std::pmr::unordered_map<std::pmr::string, Record>;
+
+// Heap allocations made inside the parse loops, summed over the threads
+static std::atomic<uint64_t> loop_allocations = 0;
+
+Result process_parallel(MappedFile &file, size_t chunks, Arena &arena) {
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::pmr::vector<DB> dbs(chunks, &arena);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            uint64_t before = thread_heap_allocations;
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input(dbs[idx], chunk);
+                chunk = file.next_chunk();
+            }
+            loop_allocations += thread_heap_allocations - before;
+        });
+    }
+    runners.clear(); // join threads
+
+    // Merge the partial DBs
+    Result merged(&arena);
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk.filled_) {
+            auto it = merged.find(db_chunk.keys_[idx]);
+            if (it == merged.end()) {
+                merged.insert_or_assign(db_chunk.keys_[idx],
+                                        db_chunk.values_[idx]);
+            } else {
+                it->second.cnt += db_chunk.values_[idx].cnt;
+                it->second.sum += db_chunk.values_[idx].sum;
+                it->second.max =
+                    std::max(it->second.max, db_chunk.values_[idx].max);
+                it->second.min =
+                    std::min(it->second.min, db_chunk.values_[idx].min);
+            }
+        }
+    }
+    return merged;
+}
+
+void format_output(std::ostream &out, Result &db) {
+    std::pmr::vector<std::pmr::string> names(db.size(), db.get_allocator());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+// The arena needs room for the per-thread tables (including the names that
+// don't fit into the small string buffer) and the merged result
+static size_t arena_capacity(size_t chunks) {
+    size_t slots = UINT16_MAX + 1;
+    size_t per_table =
+        slots * (sizeof(std::pmr::string) + sizeof(Record) + sizeof(size_t));
+    size_t names = slots * 128;
+    return (chunks + 1) * (per_table + names) + 64 * 1024 * 1024;
+}
+
+int main(int argc, char **argv) {
+    // Usage: 17_arena [threads] [chunk_mb] [--pages=normal|thp|huge] [--stats]
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    Arena::Pages pages = Arena::Pages::Transparent;
+    bool stats = false;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--pages=normal")
+            pages = Arena::Pages::Normal;
+        else if (arg == "--pages=thp")
+            pages = Arena::Pages::Transparent;
+        else if (arg == "--pages=huge")
+            pages = Arena::Pages::Huge;
+        else if (arg == "--stats")
+            stats = true;
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    {
+        Arena arena(arena_capacity(chunks), pages);
+        auto db = process_parallel(mfile, chunks, arena);
+        format_output(std::cout, db);
+
+        if (stats) {
+            static constexpr const char *page_names[] = {"normal", "thp",
+                                                         "huge"};
+            std::cerr << "arena: " << page_names[int(arena.pages())]
+                      << " pages, " << arena.used() / 1024 << " of "
+                      << arena.capacity() / 1024 << " KB used, "
+                      << arena.allocations() << " allocations, "
+                      << arena.overflows() << " overflows\n";
+            std::cerr << "heap: " << heap_allocations << " allocations ("
+                      << heap_bytes << " bytes), " << loop_allocations
+                      << " in the parse loops\n";
+        }
+        // The tables only ever referenced the arena, destroying them doesn't
+        // free anything, the arena itself is a single munmap.
+    }
+}
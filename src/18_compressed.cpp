@@ -0,0 +1,668 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+using Result = std::unordered_map<std::string, Record>;
+
+// Merge the partial DBs
+Result merge(std::span<const DB> dbs) {
+    Result merged;
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk.filled_) {
+            auto it = merged.find(db_chunk.keys_[idx]);
+            if (it == merged.end()) {
+                merged.insert_or_assign(db_chunk.keys_[idx],
+                                        db_chunk.values_[idx]);
+            } else {
+                it->second.cnt += db_chunk.values_[idx].cnt;
+                it->second.sum += db_chunk.values_[idx].sum;
+                it->second.max =
+                    std::max(it->second.max, db_chunk.values_[idx].max);
+                it->second.min =
+                    std::min(it->second.min, db_chunk.values_[idx].min);
+            }
+        }
+    }
+    return merged;
+}
+
+// Uncompressed input, the dynamic chunks from 09_dynamic_chunks.cpp
+Result process_plain(MappedFile &file, size_t threads) {
+    std::vector<std::jthread> runners(threads);
+    std::vector<DB> dbs(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input(dbs[idx], chunk);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+    return merge(dbs);
+}
+
+// The decompressed data of a block (frame) only contains complete lines in
+// the middle, the partial lines at either end continue in the neighbouring
+// blocks. The workers keep the fragments, and they are joined in order once
+// all blocks are done.
+struct Fragments {
+    std::string head; // up to and including the first '\n'
+    std::string tail; // after the last '\n'
+    bool has_newline = false;
+};
+
+// Process the complete lines of a decompressed block, keep the rest
+void process_block(DB &db, std::span<const char> data, Fragments &fragments) {
+    auto first = std::ranges::find(data, '\n');
+    if (first == data.end()) {
+        fragments.head.assign(data.begin(), data.end());
+        return;
+    }
+    auto last = std::ranges::find(data | std::views::reverse, '\n').base();
+    fragments.has_newline = true;
+    fragments.head.assign(data.begin(), first + 1);
+    fragments.tail.assign(last, data.end());
+    process_input(db, {first + 1, last});
+}
+
+// Stitch the fragments of consecutive blocks back into lines
+void process_fragments(DB &db, std::span<Fragments> blocks) {
+    std::string carry;
+    for (auto &block : blocks) {
+        carry += block.head;
+        if (not block.has_newline)
+            continue;
+        process_input(db, carry);
+        carry = std::move(block.tail);
+    }
+    // The last line might be missing the newline
+    if (not carry.empty()) {
+        carry.push_back('\n');
+        process_input(db, carry);
+    }
+}
+
+#ifdef HAVE_ZSTD
+// zstd: every frame (e.g. of the seekable format) can be decompressed
+// independently, the workers take the frames in order and decompress them
+// straight into their own buffer.
+
+// Skippable frames carry metadata, e.g. the seek table
+static bool skippable_frame(std::span<const char> data) {
+    uint32_t magic;
+    memcpy(&magic, data.data(), sizeof(magic));
+    return (magic & 0xFFFFFFF0) == ZSTD_MAGIC_SKIPPABLE_START;
+}
+
+static std::vector<std::span<const char>>
+zstd_frames(std::span<const char> data) {
+    std::vector<std::span<const char>> frames;
+    while (not data.empty()) {
+        size_t size = ZSTD_findFrameCompressedSize(data.data(), data.size());
+        if (ZSTD_isError(size))
+            throw std::runtime_error(std::string("Corrupted zstd input: ") +
+                                     ZSTD_getErrorName(size));
+        if (not skippable_frame(data))
+            frames.push_back(data.first(size));
+        data = data.subspan(size);
+    }
+    return frames;
+}
+
+static void decompress_frame(ZSTD_DCtx *ctx, std::span<const char> frame,
+                             std::vector<char> &out) {
+    unsigned long long size =
+        ZSTD_getFrameContentSize(frame.data(), frame.size());
+    if (size != ZSTD_CONTENTSIZE_UNKNOWN && size != ZSTD_CONTENTSIZE_ERROR) {
+        out.resize(size);
+        size_t result = ZSTD_decompressDCtx(ctx, out.data(), out.size(),
+                                            frame.data(), frame.size());
+        if (ZSTD_isError(result))
+            throw std::runtime_error(std::string("zstd: ") +
+                                     ZSTD_getErrorName(result));
+        return;
+    }
+
+    // No content size in the header, stream into a growing buffer
+    ZSTD_DCtx_reset(ctx, ZSTD_reset_session_only);
+    ZSTD_inBuffer in{frame.data(), frame.size(), 0};
+    out.resize(std::max(out.capacity(), ZSTD_DStreamOutSize()));
+    size_t filled = 0;
+    while (true) {
+        if (filled == out.size())
+            out.resize(out.size() * 2);
+        ZSTD_outBuffer dst{out.data() + filled, out.size() - filled, 0};
+        size_t result = ZSTD_decompressStream(ctx, &dst, &in);
+        if (ZSTD_isError(result))
+            throw std::runtime_error(std::string("zstd: ") +
+                                     ZSTD_getErrorName(result));
+        filled += dst.pos;
+        if (result == 0)
+            break;
+    }
+    out.resize(filled);
+}
+
+Result process_zstd(std::span<const char> data, size_t threads) {
+    auto frames = zstd_frames(data);
+    std::vector<Fragments> fragments(frames.size());
+
+    std::atomic<size_t> next_frame = 0;
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::jthread> runners(threads);
+    std::vector<DB> dbs(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            try {
+                std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx(
+                    ZSTD_createDCtx(), ZSTD_freeDCtx);
+                std::vector<char> buffer;
+                for (size_t frame = next_frame++; frame < frames.size();
+                     frame = next_frame++) {
+                    decompress_frame(ctx.get(), frames[frame], buffer);
+                    process_block(dbs[idx], buffer, fragments[frame]);
+                }
+            } catch (...) {
+                errors[idx] = std::current_exception();
+            }
+        });
+    }
+    runners.clear(); // join threads
+    for (auto &error : errors)
+        if (error)
+            std::rethrow_exception(error);
+
+    process_fragments(dbs[0], fragments);
+    return merge(dbs);
+}
+#endif
+
+// gzip: a single deflate stream can only be decompressed sequentially. The
+// reader thread inflates into fixed size blocks that end on a line boundary
+// (the partial line is carried into the next block), the workers parse the
+// blocks while the reader is already decompressing the next one.
+class BlockQueue {
+  public:
+    explicit BlockQueue(size_t blocks) {
+        for (size_t i = 0; i < blocks; ++i)
+            free_.emplace_back();
+    }
+
+    // Reader side: an empty block to fill
+    std::vector<char> get_free() {
+        std::unique_lock lock{mux_};
+        cv_.wait(lock, [&] { return not free_.empty(); });
+        auto block = std::move(free_.back());
+        free_.pop_back();
+        return block;
+    }
+
+    void push_full(std::vector<char> block) {
+        {
+            std::lock_guard lock{mux_};
+            full_.push_back(std::move(block));
+        }
+        cv_.notify_all();
+    }
+
+    void close() {
+        {
+            std::lock_guard lock{mux_};
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    // Worker side: the next filled block, false once the input is done
+    bool get_full(std::vector<char> &block) {
+        std::unique_lock lock{mux_};
+        cv_.wait(lock, [&] { return closed_ || not full_.empty(); });
+        if (full_.empty())
+            return false;
+        block = std::move(full_.front());
+        full_.pop_front();
+        return true;
+    }
+
+    void put_free(std::vector<char> block) {
+        {
+            std::lock_guard lock{mux_};
+            free_.push_back(std::move(block));
+        }
+        cv_.notify_all();
+    }
+
+  private:
+    std::mutex mux_;
+    std::condition_variable cv_;
+    std::vector<std::vector<char>> free_;
+    std::deque<std::vector<char>> full_;
+    bool closed_ = false;
+};
+
+static void inflate_blocks(std::span<const char> data, BlockQueue &queue,
+                           size_t block_size) {
+    z_stream stream{};
+    // 15 + 32: maximum window, detect the gzip or zlib header
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+        throw std::runtime_error("Failed to initialize zlib");
+    std::unique_ptr<z_stream, decltype(&inflateEnd)> guard(&stream,
+                                                           inflateEnd);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = 0;
+    size_t remaining = data.size();
+
+    std::string carry;
+    bool done = false;
+    // The input has to end right after a complete member
+    bool member_end = false;
+    while (not done) {
+        auto block = queue.get_free();
+        block.resize(block_size + carry.size());
+        std::ranges::copy(carry, block.begin());
+        size_t filled = carry.size();
+
+        while (filled < block.size()) {
+            if (stream.avail_in == 0) {
+                if (remaining == 0) {
+                    if (not member_end)
+                        throw std::runtime_error(
+                            "Corrupted gzip input: truncated");
+                    done = true;
+                    break;
+                }
+                // avail_in is only 32 bits
+                stream.avail_in = std::min<size_t>(remaining, 1 << 30);
+                remaining -= stream.avail_in;
+            }
+            stream.next_out = reinterpret_cast<Bytef *>(block.data() + filled);
+            stream.avail_out = block.size() - filled;
+            int result = inflate(&stream, Z_NO_FLUSH);
+            filled = block.size() - stream.avail_out;
+            member_end = result == Z_STREAM_END;
+            if (result == Z_STREAM_END) {
+                // Concatenated gzip members continue with a new header
+                if (stream.avail_in == 0 && remaining == 0) {
+                    done = true;
+                    break;
+                }
+                inflateReset(&stream);
+            } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("Corrupted gzip input: ") +
+                                         (stream.msg ? stream.msg : "unknown"));
+            }
+        }
+        block.resize(filled);
+
+        // Only hand out complete lines
+        auto last = std::ranges::find(block | std::views::reverse, '\n').base();
+        carry.assign(last, block.end());
+        block.erase(last, block.end());
+        if (done && not carry.empty()) {
+            block.insert(block.end(), carry.begin(), carry.end());
+            block.push_back('\n');
+        }
+        queue.push_full(std::move(block));
+    }
+}
+
+Result process_gzip(std::span<const char> data, size_t threads,
+                    size_t block_size) {
+    BlockQueue queue(threads + 2);
+    std::exception_ptr error;
+    std::jthread reader([&]() {
+        try {
+            inflate_blocks(data, queue, block_size);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        queue.close();
+    });
+
+    std::vector<std::jthread> runners(threads);
+    std::vector<DB> dbs(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            std::vector<char> block;
+            while (queue.get_full(block)) {
+                process_input(dbs[idx], block);
+                queue.put_free(std::move(block));
+            }
+        });
+    }
+    reader.join();
+    runners.clear(); // join threads
+    if (error)
+        std::rethrow_exception(error);
+    return merge(dbs);
+}
+
+void format_output(std::ostream &out, Result &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+enum class Format { Plain, Zstd, Gzip };
+
+static Format detect_format(std::span<const char> data) {
+    if (data.size() < 4)
+        return Format::Plain;
+    uint32_t magic;
+    memcpy(&magic, data.data(), sizeof(magic));
+    // A zstd frame or a skippable frame (e.g. a seek table up front)
+    if (magic == 0xFD2FB528 || (magic & 0xFFFFFFF0) == 0x184D2A50)
+        return Format::Zstd;
+    if ((magic & 0xFFFF) == 0x8B1F)
+        return Format::Gzip;
+    return Format::Plain;
+}
+
+// gzip blocks are handed to the workers as they are decompressed, they are
+// much smaller than the chunks of the uncompressed input
+static constexpr size_t gzip_block_size = 4 * 1024 * 1024;
+
+int main(int argc, char **argv) try {
+    // Usage: 18_compressed [threads] [chunk_mb] [--input=FILE]
+    //
+    // The input can be plain text, zstd (one or more frames, e.g. the
+    // seekable format) or gzip, detected from the magic number.
+    size_t threads = 1;
+    size_t chunk_mb = 64;
+    std::filesystem::path input = "measurements.txt";
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--input="))
+            input = arg.substr(arg.find('=') + 1);
+        else if (pos++ == 0)
+            threads = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile(input, chunk_mb * 1024 * 1024);
+    auto data = mfile.data();
+
+    Result db;
+    switch (detect_format(data)) {
+    case Format::Zstd:
+#ifdef HAVE_ZSTD
+        db = process_zstd(data, threads);
+        break;
+#else
+        throw std::runtime_error("zstd input, but built without zstd support");
+#endif
+    case Format::Gzip:
+        db = process_gzip(data, threads, gzip_block_size);
+        break;
+    case Format::Plain:
+        db = process_plain(mfile, threads);
+        break;
+    }
+    format_output(std::cout, db);
+} catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,631 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <ranges>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    // Take ownership of a descriptor, e.g. a socket
+    explicit FileFD(int fd) : fd_(fd) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Invalid file descriptor");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+// The merged aggregates as seen by the queries, sorted by name
+struct Entry {
+    std::string name;
+    Record value;
+};
+
+struct Snapshot {
+    std::vector<Entry> entries;
+    uint64_t rows = 0;
+    uint64_t version = 0;
+    // The full output, formatted once when the snapshot is built
+    std::string all;
+};
+
+// Expects the stream to be in fixed mode with precision 1
+void format_entry(std::ostream &out, const Entry &entry) {
+    int64_t sum = entry.value.sum;
+    // Correct rounding
+    if (sum > 0)
+        sum += entry.value.cnt / 2;
+    else
+        sum -= entry.value.cnt / 2;
+    out << entry.name << "=" << entry.value.min / 10.0 << "/"
+        << (sum / entry.value.cnt) / 10.0 << "/" << entry.value.max / 10.0;
+}
+
+void format_entries(std::ostream &out, std::span<const Entry> entries) {
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &entry : entries) {
+        out << std::exchange(delim, ", ");
+        format_entry(out, entry);
+    }
+    out << "}\n";
+}
+
+// Epoch-based publication of immutable values: a single writer replaces the
+// current value, readers pin it without taking a lock. Before loading the
+// pointer, a reader announces the epoch it started in. A replaced value is
+// retired with the epoch of its replacement and only freed once every active
+// reader has announced that epoch or a later one, i.e. started after the
+// value was unlinked.
+template <typename T> class Published {
+  public:
+    static constexpr size_t max_readers = 64;
+
+    ~Published() {
+        delete current_.load();
+        for (auto &retired : retired_)
+            delete retired.value;
+    }
+
+    // Writer side, only ever called from one thread
+    void publish(std::unique_ptr<T> value) {
+        T *old = current_.exchange(value.release());
+        uint64_t epoch = epoch_.fetch_add(1) + 1;
+        if (old != nullptr)
+            retired_.push_back({old, epoch});
+
+        uint64_t oldest = UINT64_MAX;
+        for (auto &reader : readers_) {
+            uint64_t announced = reader.load();
+            if (announced != 0)
+                oldest = std::min(oldest, announced);
+        }
+        std::erase_if(retired_, [&](const Retired &retired) {
+            if (retired.epoch > oldest)
+                return false;
+            delete retired.value;
+            return true;
+        });
+    }
+
+    // Reader side: the value stays valid while the guard is alive. Every
+    // reading thread uses its own slot.
+    class Guard {
+      public:
+        Guard(Published &cell, size_t slot) : slot_(cell.readers_[slot]) {
+            slot_.store(cell.epoch_.load());
+            value_ = cell.current_.load();
+        }
+        ~Guard() { slot_.store(0); }
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+        const T *get() const { return value_; }
+
+      private:
+        std::atomic<uint64_t> &slot_;
+        const T *value_;
+    };
+
+  private:
+    struct Retired {
+        T *value;
+        uint64_t epoch;
+    };
+
+    std::atomic<T *> current_ = nullptr;
+    // Starts at 1, an announced epoch of 0 means the slot is idle
+    std::atomic<uint64_t> epoch_ = 1;
+    std::array<std::atomic<uint64_t>, max_readers> readers_{};
+    std::vector<Retired> retired_;
+};
+
+struct Options {
+    std::vector<std::filesystem::path> files;
+    std::filesystem::path socket = "1brc.sock";
+    std::chrono::milliseconds interval{100};
+    std::chrono::milliseconds poll{10};
+};
+
+static std::atomic<bool> stop_requested = false;
+
+// One growing file, fed through the parse/DB path by its own thread. The
+// thread owns the DB, the merger only sees the copies in the stash.
+struct Tailer {
+    explicit Tailer(std::filesystem::path file)
+        : path(std::move(file)), db(std::make_unique<DB>()) {}
+
+    std::filesystem::path path;
+    std::unique_ptr<DB> db;
+
+    std::mutex mux;
+    std::vector<Entry> stash;
+    bool dirty = false;
+};
+
+static void publish_stash(Tailer &tailer) {
+    std::vector<Entry> entries;
+    entries.reserve(tailer.db->filled_.size());
+    for (auto idx : tailer.db->filled_)
+        entries.push_back({tailer.db->keys_[idx], tailer.db->values_[idx]});
+
+    std::lock_guard lock{tailer.mux};
+    tailer.stash = std::move(entries);
+    tailer.dirty = true;
+}
+
+// Read whatever was appended since the last round, process the complete
+// lines and carry the partial last line over to the next round.
+static void tail_file(Tailer &tailer, const Options &opts) {
+    static constexpr size_t read_size = 16 * 1024 * 1024;
+
+    FileFD fd(tailer.path);
+    std::vector<char> buffer(read_size);
+    std::string carry;
+    off_t offset = 0;
+    auto last_publish = std::chrono::steady_clock::now();
+    bool changed = false;
+
+    while (not stop_requested) {
+        struct stat sb;
+        if (fstat(fd.get(), &sb) == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        if (sb.st_size < offset) {
+            // Truncated (e.g. copytruncate rotation), continue from the start
+            std::cerr << tailer.path << " was truncated\n";
+            offset = 0;
+            carry.clear();
+        }
+
+        if (sb.st_size > offset) {
+            ssize_t cnt = pread(fd.get(), buffer.data(), buffer.size(), offset);
+            if (cnt == -1)
+                throw std::system_error(errno, std::system_category(),
+                                        "Failed to read " +
+                                            tailer.path.string());
+            offset += cnt;
+            std::span<const char> data(buffer.data(), cnt);
+
+            auto first = std::ranges::find(data, '\n');
+            if (first == data.end()) {
+                carry.append(data.begin(), data.end());
+                continue;
+            }
+            auto last =
+                std::ranges::find(data | std::views::reverse, '\n').base();
+            auto begin = data.begin();
+            if (not carry.empty()) {
+                carry.append(begin, first + 1);
+                process_input(*tailer.db, carry);
+                carry.clear();
+                begin = first + 1;
+            }
+            process_input(*tailer.db, {begin, last});
+            carry.assign(last, data.end());
+            changed = true;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (changed && now - last_publish >= opts.interval) {
+            publish_stash(tailer);
+            last_publish = now;
+            changed = false;
+        }
+        if (sb.st_size == offset)
+            std::this_thread::sleep_for(opts.poll);
+    }
+}
+
+// Combine the latest stashes of all files into a new snapshot
+static std::unique_ptr<Snapshot>
+merge_stashes(std::span<const std::vector<Entry>> latest, uint64_t version) {
+    std::unordered_map<std::string, Record> merged;
+    for (auto &entries : latest) {
+        for (auto &[name, value] : entries) {
+            auto it = merged.find(name);
+            if (it == merged.end()) {
+                merged.insert_or_assign(name, value);
+            } else {
+                it->second.cnt += value.cnt;
+                it->second.sum += value.sum;
+                it->second.max = std::max(it->second.max, value.max);
+                it->second.min = std::min(it->second.min, value.min);
+            }
+        }
+    }
+
+    auto snapshot = std::make_unique<Snapshot>();
+    snapshot->version = version;
+    for (auto &[name, value] : merged) {
+        snapshot->entries.push_back({name, value});
+        snapshot->rows += value.cnt;
+    }
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(snapshot->entries, std::less<>{}, &Entry::name);
+
+    std::ostringstream out;
+    format_entries(out, snapshot->entries);
+    snapshot->all = std::move(out).str();
+    return snapshot;
+}
+
+static void merge_loop(std::span<Tailer> tailers, Published<Snapshot> &cell,
+                       const Options &opts) {
+    std::vector<std::vector<Entry>> latest(tailers.size());
+    uint64_t version = 0;
+    while (not stop_requested) {
+        bool changed = false;
+        for (size_t i = 0; i < tailers.size(); ++i) {
+            std::lock_guard lock{tailers[i].mux};
+            if (not tailers[i].dirty)
+                continue;
+            std::swap(latest[i], tailers[i].stash);
+            tailers[i].dirty = false;
+            changed = true;
+        }
+        if (changed)
+            cell.publish(merge_stashes(latest, ++version));
+        std::this_thread::sleep_for(opts.interval);
+    }
+}
+
+// Query protocol, one request per line:
+//   all              the full output, like the batch binaries
+//   prefix <text>    the stations starting with <text>, same format
+//   station <name>   "<name>=min/mean/max", or "?" if unknown
+//   stats            "rows=<n> stations=<n> version=<n>"
+static std::string answer(std::string_view query, const Snapshot *snapshot) {
+    static const Snapshot empty{{}, 0, 0, "{}\n"};
+    if (snapshot == nullptr)
+        snapshot = &empty;
+    auto &entries = snapshot->entries;
+
+    if (query == "all")
+        return snapshot->all;
+    if (query == "stats")
+        return "rows=" + std::to_string(snapshot->rows) +
+               " stations=" + std::to_string(entries.size()) +
+               " version=" + std::to_string(snapshot->version) + "\n";
+    if (query.starts_with("prefix ")) {
+        auto prefix = query.substr(7);
+        auto begin = std::ranges::lower_bound(entries, prefix, std::less<>{},
+                                              &Entry::name);
+        auto end = std::find_if_not(begin, entries.end(), [&](auto &entry) {
+            return entry.name.starts_with(prefix);
+        });
+        std::ostringstream out;
+        format_entries(out, {begin, end});
+        return std::move(out).str();
+    }
+    if (query.starts_with("station ")) {
+        auto name = query.substr(8);
+        auto it = std::ranges::lower_bound(entries, name, std::less<>{},
+                                           &Entry::name);
+        if (it == entries.end() || it->name != name)
+            return "?\n";
+        std::ostringstream out;
+        out << std::setiosflags(out.fixed | out.showpoint)
+            << std::setprecision(1);
+        format_entry(out, *it);
+        out << "\n";
+        return std::move(out).str();
+    }
+    return "error: unknown query\n";
+}
+
+static bool write_all(int fd, std::string_view data) {
+    while (not data.empty()) {
+        ssize_t cnt = write(fd, data.data(), data.size());
+        if (cnt == -1 && errno == EINTR)
+            continue;
+        if (cnt <= 0)
+            return false;
+        data.remove_prefix(cnt);
+    }
+    return true;
+}
+
+// Serve the queries from a single thread, the snapshot is pinned per query
+static void serve(const Options &opts, Published<Snapshot> &cell) {
+    FileFD listener(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (opts.socket.native().size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("Socket path too long: " +
+                                 opts.socket.string());
+    std::ranges::copy(opts.socket.native(), addr.sun_path);
+    unlink(opts.socket.c_str());
+    if (bind(listener.get(), reinterpret_cast<sockaddr *>(&addr),
+             sizeof(addr)) == -1 ||
+        listen(listener.get(), 16) == -1)
+        throw std::system_error(errno, std::system_category(),
+                                "Failed to listen on " + opts.socket.string());
+
+    struct Client {
+        explicit Client(int fd) : fd(fd) {}
+
+        FileFD fd;
+        std::string pending;
+    };
+    std::list<Client> clients;
+    std::vector<pollfd> fds;
+    char buffer[4096];
+    while (not stop_requested) {
+        fds.clear();
+        fds.push_back({listener.get(), POLLIN, 0});
+        for (auto &client : clients)
+            fds.push_back({client.fd.get(), POLLIN, 0});
+        if (poll(fds.data(), fds.size(), 100) <= 0)
+            continue;
+
+        auto it = clients.begin();
+        for (size_t i = 1; i < fds.size(); ++i) {
+            if (fds[i].revents == 0) {
+                ++it;
+                continue;
+            }
+            auto &client = *it;
+            ssize_t cnt = read(client.fd.get(), buffer, sizeof(buffer));
+            bool open = cnt > 0;
+            if (open)
+                client.pending.append(buffer, cnt);
+            size_t eol;
+            while (open &&
+                   (eol = client.pending.find('\n')) != std::string::npos) {
+                std::string_view query(client.pending.data(), eol);
+                if (query.ends_with('\r'))
+                    query.remove_suffix(1);
+                Published<Snapshot>::Guard guard(cell, 0);
+                open = write_all(client.fd.get(), answer(query, guard.get()));
+                client.pending.erase(0, eol + 1);
+            }
+            it = open ? std::next(it) : clients.erase(it);
+        }
+
+        // New clients are polled from the next round on
+        if (fds[0].revents & POLLIN) {
+            int fd = accept4(listener.get(), nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd != -1)
+                clients.emplace_back(fd);
+        }
+    }
+    unlink(opts.socket.c_str());
+}
+
+static void on_signal(int) { stop_requested = true; }
+
+int main(int argc, char **argv) try {
+    // Usage: 19_daemon [--socket=PATH] [--interval-ms=100] [--poll-ms=10]
+    //            [FILE...]
+    //
+    // Tails the files (measurements.txt by default) and serves queries on
+    // the Unix domain socket until SIGINT/SIGTERM. The snapshot is refreshed
+    // every interval if any of the files grew.
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = arg.substr(arg.find('=') + 1);
+        if (arg.starts_with("--socket="))
+            opts.socket = value;
+        else if (arg.starts_with("--interval-ms="))
+            opts.interval = std::chrono::milliseconds(atol(value.data()));
+        else if (arg.starts_with("--poll-ms="))
+            opts.poll = std::chrono::milliseconds(atol(value.data()));
+        else
+            opts.files.push_back(arg);
+    }
+    if (opts.files.empty())
+        opts.files.push_back("measurements.txt");
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    // A client that disconnects mid-answer is only a failed write
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // A failure in any thread shuts everything down
+    auto guarded = [](auto fn) {
+        try {
+            fn();
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << "\n";
+            stop_requested = true;
+        }
+    };
+
+    std::vector<Tailer> tailers(opts.files.begin(), opts.files.end());
+    Published<Snapshot> cell;
+    std::vector<std::jthread> threads;
+    struct StopOnExit {
+        ~StopOnExit() { stop_requested = true; }
+    } stop_on_exit; // before the threads are joined, also on exceptions
+    for (auto &tailer : tailers)
+        threads.emplace_back(
+            [&] { guarded([&] { tail_file(tailer, opts); }); });
+    threads.emplace_back(
+        [&] { guarded([&] { merge_loop(tailers, cell, opts); }); });
+    serve(opts, cell);
+} catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,788 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <immintrin.h>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+// The first 16 bytes of the name (zero padded) are stored inline, the name
+// itself points into the mapped file.
+struct Key {
+    uint64_t prefix[2];
+    const char *name;
+    uint32_t len;
+    uint32_t hash;
+};
+
+struct alignas(64) Slot {
+    Key key;
+    Record value;
+};
+
+static uint32_t key_hash(uint64_t p0, uint64_t p1, uint32_t len) {
+    uint64_t h = (p0 ^ std::rotl(p1, 29) ^ len) * 0x9E3779B97F4A7C15;
+    return h >> 32;
+}
+
+// Mask for the first "bytes" bytes of a little endian word
+static uint64_t low_bytes(size_t bytes) {
+    return bytes >= 8 ? ~uint64_t{0} : (uint64_t{1} << (bytes * 8)) - 1;
+}
+
+static uint64_t load_word(const char *ptr) {
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+// A batch of parsed lines in structure of arrays form
+static constexpr size_t batch_size = 16;
+
+struct Batch {
+    const char *name[batch_size];
+    uint32_t len[batch_size];
+    uint64_t prefix0[batch_size];
+    uint64_t prefix1[batch_size];
+    uint32_t hash[batch_size];
+    int16_t value[batch_size];
+};
+
+// Open addressing table, grows at 50% load
+struct Table {
+    explicit Table(size_t capacity = 1 << 14)
+        : slots_(capacity), mask_(capacity - 1) {}
+
+    void record_batch(const Batch &batch, size_t lines) {
+        for (size_t i = 0; i < lines; ++i) {
+            Key key{{batch.prefix0[i], batch.prefix1[i]},
+                    batch.name[i],
+                    batch.len[i],
+                    batch.hash[i]};
+            record(key, batch.value[i]);
+        }
+    }
+
+    void record(const Key &key, int16_t value) {
+        Slot &slot = lookup_slot(key);
+
+        // If the slot is empty, we have a miss
+        if (slot.key.name == nullptr) {
+            slot.key = key;
+            slot.value = Record{1, value, value, value};
+            if (++filled_ * 2 > slots_.size())
+                grow();
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (value < slot.value.min)
+            slot.value.min = value;
+        else if (value > slot.value.max)
+            slot.value.max = value;
+        slot.value.sum += value;
+        ++slot.value.cnt;
+    }
+
+    Slot &lookup_slot(const Key &key) {
+        size_t idx = key.hash & mask_;
+
+        // While the slot is already occupied
+        while (slots_[idx].key.name != nullptr) {
+            // If it is the same name, we have a hit
+            if (same_key(slots_[idx].key, key))
+                break;
+            // Otherwise we have a collision
+            idx = (idx + 1) & mask_;
+        }
+
+        // Either the first empty slot or a hit
+        return slots_[idx];
+    }
+
+    static bool same_key(const Key &left, const Key &right) {
+        if (left.len != right.len || left.prefix[0] != right.prefix[0] ||
+            left.prefix[1] != right.prefix[1])
+            return false;
+        return left.len <= 16 ||
+               memcmp(left.name + 16, right.name + 16, left.len - 16) == 0;
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots_.size() * 2);
+        std::swap(old, slots_);
+        mask_ = slots_.size() - 1;
+        for (auto &slot : old) {
+            if (slot.key.name == nullptr)
+                continue;
+            size_t idx = slot.key.hash & mask_;
+            while (slots_[idx].key.name != nullptr)
+                idx = (idx + 1) & mask_;
+            slots_[idx] = slot;
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t filled_ = 0;
+};
+
+// Bitmasks of the ';' and '\n' bytes in a 64 byte block, and of the bytes
+// that need a closer look: control characters other than '\n' (e.g. '\r')
+// and non-ASCII bytes (which have to be valid UTF-8)
+struct BlockMasks {
+    uint64_t semicolons;
+    uint64_t newlines;
+    uint64_t suspicious;
+};
+
+static BlockMasks scan_block(const char *ptr) {
+    // SSE2 is part of the x86-64 baseline
+    BlockMasks result{0, 0, 0};
+    for (size_t i = 0; i < 4; ++i) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + i * 16));
+        uint32_t semi =
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(';')));
+        uint32_t nl =
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+        // Signed compare, the non-ASCII bytes are negative
+        uint32_t low =
+            _mm_movemask_epi8(_mm_cmplt_epi8(block, _mm_set1_epi8(0x20)));
+        result.semicolons |= uint64_t{semi} << (i * 16);
+        result.newlines |= uint64_t{nl} << (i * 16);
+        result.suspicious |= uint64_t{low & ~nl} << (i * 16);
+    }
+    return result;
+}
+
+// Decode "-?d?d.d\n" from a single 8 byte load (merykitty's SWAR decoding)
+static int16_t decode_value(uint64_t word) {
+    int dot_bit = std::countr_zero(~word & 0x10101000);
+    int shift = 28 - dot_bit;
+    int64_t sign = (int64_t(~word) << 59) >> 63;
+    uint64_t design_mask = ~(sign & 0xFF);
+    uint64_t digits = ((word & design_mask) << shift) & 0x0F000F0F00;
+    uint64_t abs_value = ((digits * 0x640a0001) >> 32) & 0x3FF;
+    return int16_t((abs_value ^ sign) - sign);
+}
+
+// Check that the "len" bytes of "word" are "-?d?d.d", branch free apart from
+// the length
+static bool valid_value(uint64_t word, size_t len) {
+    uint64_t sign = (word & 0xFF) == '-';
+    if (len < 3 + sign || len > 4 + sign)
+        return false;
+    size_t dot = (len - 2) * 8;
+    // The digits are 0..9 after the xor, anything else has the top bit set
+    // after adding 0x76 (the top bit is masked to avoid carries)
+    uint64_t x = word ^ 0x3030303030303030;
+    uint64_t other = (((x & 0x7F7F7F7F7F7F7F7F) + 0x7676767676767676) | x) &
+                     0x8080808080808080;
+    uint64_t digits =
+        low_bytes(len) & ~(uint64_t{0xFF} << dot) & ~(sign * 0xFF);
+    return ((word >> dot) & 0xFF) == '.' && (other & digits) == 0;
+}
+
+// Load 8 bytes, zero filled past the end of the file
+static uint64_t load_word_safe(const char *ptr, const char *file_end) {
+    if (ptr + 8 <= file_end)
+        return load_word(ptr);
+    uint64_t word = 0;
+    memcpy(&word, ptr, file_end - ptr);
+    return word;
+}
+
+static Key make_key(const char *name, size_t len, const char *file_end) {
+    Key key;
+    key.name = name;
+    key.len = len;
+    key.prefix[0] = load_word_safe(name, file_end) & low_bytes(len);
+    key.prefix[1] =
+        len > 8 ? load_word_safe(name + 8, file_end) & low_bytes(len - 8) : 0;
+    key.hash = key_hash(key.prefix[0], key.prefix[1], key.len);
+    return key;
+}
+
+// Decode a batch of lines, given the offsets of their ';' and '\n'. Every
+// step is a loop over the independent lanes, there is no dependency between
+// the lines of the batch.
+static void decode_batch(Batch &batch, const char *base, size_t line_begin,
+                         const uint64_t *semicolons, const uint64_t *newlines,
+                         size_t lines, const char *file_end) {
+    for (size_t i = 0; i < lines; ++i) {
+        size_t begin = i == 0 ? line_begin : newlines[i - 1] + 1;
+        batch.name[i] = base + begin;
+        batch.len[i] = semicolons[i] - begin;
+    }
+    for (size_t i = 0; i < lines; ++i) {
+        const char *name = batch.name[i];
+        uint32_t len = batch.len[i];
+        batch.prefix0[i] = load_word_safe(name, file_end) & low_bytes(len);
+        batch.prefix1[i] = len > 8 ? load_word_safe(name + 8, file_end) &
+                                         low_bytes(len - 8)
+                                   : 0;
+    }
+    for (size_t i = 0; i < lines; ++i)
+        batch.hash[i] =
+            key_hash(batch.prefix0[i], batch.prefix1[i], batch.len[i]);
+    for (size_t i = 0; i < lines; ++i)
+        batch.value[i] = decode_value(
+            load_word_safe(base + semicolons[i] + 1, file_end));
+}
+
+// The shape of a batch: every line has exactly one ';', a name of 1 to 100
+// bytes and a "-?d?d.d" value. "next_semicolon" is the first ';' after the
+// batch (or SIZE_MAX), to catch a second ';' in the last line.
+static bool valid_batch(const char *base, size_t line_begin,
+                        const uint64_t *semicolons, const uint64_t *newlines,
+                        size_t lines, uint64_t next_semicolon,
+                        const char *file_end) {
+    bool valid = true;
+    for (size_t i = 0; i < lines; ++i) {
+        size_t begin = i == 0 ? line_begin : newlines[i - 1] + 1;
+        size_t end = i + 1 < lines ? semicolons[i + 1] : next_semicolon;
+        valid &= semicolons[i] > begin && semicolons[i] - begin <= 100 &&
+                 semicolons[i] < newlines[i] && end > newlines[i];
+        valid &= valid_value(load_word_safe(base + semicolons[i] + 1, file_end),
+                             newlines[i] - semicolons[i] - 1);
+    }
+    return valid;
+}
+
+// Scalar check of the bytes in a range with suspicious blocks: no control
+// characters other than '\n', and valid UTF-8 (no overlong encodings, no
+// surrogates, nothing above U+10FFFF).
+static bool valid_bytes(const char *begin, const char *end) {
+    auto ptr = reinterpret_cast<const uint8_t *>(begin);
+    auto last = reinterpret_cast<const uint8_t *>(end);
+    while (ptr != last) {
+        uint8_t c = *ptr;
+        if (c < 0x80) {
+            if (c < 0x20 && c != '\n')
+                return false;
+            ++ptr;
+            continue;
+        }
+        size_t extra;
+        uint32_t cp;
+        if (c >= 0xC2 && c <= 0xDF) {
+            extra = 1;
+            cp = c & 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            extra = 2;
+            cp = c & 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            extra = 3;
+            cp = c & 0x07;
+        } else {
+            return false;
+        }
+        if (size_t(last - ptr) <= extra)
+            return false;
+        for (size_t i = 1; i <= extra; ++i) {
+            if ((ptr[i] & 0xC0) != 0x80)
+                return false;
+            cp = (cp << 6) | (ptr[i] & 0x3F);
+        }
+        if ((extra == 2 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) ||
+            (extra == 3 && (cp < 0x10000 || cp > 0x10FFFF)))
+            return false;
+        ptr += extra + 1;
+    }
+    return true;
+}
+
+// Parse a decimal with any number of digits, rounded to one decimal place
+static std::optional<int16_t> parse_decimal(std::string_view text) {
+    bool negative = false;
+    if (not text.empty() && (text.front() == '-' || text.front() == '+')) {
+        negative = text.front() == '-';
+        text.remove_prefix(1);
+    }
+    int32_t value = 0;
+    size_t digits = 0;
+    size_t decimals = 0;
+    bool dot = false;
+    bool round_up = false;
+    for (char c : text) {
+        if (c == '.' && not dot) {
+            dot = true;
+        } else if (c >= '0' && c <= '9') {
+            ++digits;
+            if (not dot) {
+                value = value * 10 + (c - '0');
+            } else if (decimals++ == 0) {
+                value = value * 10 + (c - '0');
+            } else if (decimals == 2) {
+                round_up = c >= '5';
+            }
+            if (value > INT16_MAX)
+                return std::nullopt;
+        } else {
+            return std::nullopt;
+        }
+    }
+    if (digits == 0)
+        return std::nullopt;
+    if (decimals == 0)
+        value *= 10;
+    value += round_up;
+    // The scaling and the rounding can still leave the range of int16_t
+    if (value > INT16_MAX)
+        return std::nullopt;
+    return negative ? -value : value;
+}
+
+// What happened to the lines of one file
+struct Report {
+    uint64_t lines = 0;
+    // Lines in batches that failed validation, parsed by the careful parser
+    uint64_t careful = 0;
+    // Accepted after fixing them up: CRLF, more than one decimal, "+"
+    uint64_t repaired = 0;
+    uint64_t empty = 0;
+    uint64_t rejected = 0;
+
+    Report &operator+=(const Report &other) {
+        lines += other.lines;
+        careful += other.careful;
+        repaired += other.repaired;
+        empty += other.empty;
+        rejected += other.rejected;
+        return *this;
+    }
+};
+
+// A rejected line and its offset in the file
+struct Rejected {
+    uint64_t offset;
+    std::string line;
+};
+
+// The careful parser, only used for the batches that failed validation.
+// Never reads outside of [begin, end).
+static void parse_careful(Table &db, const char *begin, const char *end,
+                          const char *file_begin, const char *file_end,
+                          Report &report, std::vector<Rejected> *rejected) {
+    while (begin != end) {
+        auto nl = static_cast<const char *>(memchr(begin, '\n', end - begin));
+        const char *next = nl != nullptr ? nl + 1 : end;
+        std::string_view line(begin, nl != nullptr ? nl : end);
+        ++report.lines;
+        ++report.careful;
+
+        bool repaired = false;
+        if (line.ends_with('\r')) {
+            line.remove_suffix(1);
+            repaired = true;
+        }
+        if (line.empty()) {
+            ++report.empty;
+            begin = next;
+            continue;
+        }
+
+        auto semicolon = line.rfind(';');
+        std::string_view name = line.substr(0, semicolon);
+        std::optional<int16_t> value;
+        if (semicolon != line.npos && not name.empty() && name.size() <= 100 &&
+            not name.contains(';') &&
+            valid_bytes(name.data(), name.data() + name.size())) {
+            auto text = line.substr(semicolon + 1);
+            value = parse_decimal(text);
+            repaired |= not valid_value(
+                load_word_safe(text.data(), file_end), text.size());
+        }
+        if (value && *value >= -999 && *value <= 999) {
+            db.record(make_key(name.data(), name.size(), file_end), *value);
+            report.repaired += repaired;
+        } else {
+            ++report.rejected;
+            if (rejected != nullptr)
+                rejected->push_back({uint64_t(begin - file_begin),
+                                     std::string(begin, next)});
+        }
+        begin = next;
+    }
+}
+
+// The batch parser from 13_batch_parse.cpp, with the validation. Batches that
+// are valid take the fast path, the others are handed to the careful parser
+// as a whole.
+void process_input(Table &db, std::span<const char> data,
+                   std::span<const char> file, Report &report,
+                   std::vector<Rejected> *rejected) {
+    const char *base = data.data();
+    size_t size = data.size();
+    const char *file_end = file.data() + file.size();
+
+    // Offsets of the separators that are not yet part of a decoded batch, a
+    // block adds at most 64 of each. After a careful batch, the semicolons
+    // can be ahead of the newlines.
+    uint64_t semicolons[2 * batch_size + 128];
+    uint64_t newlines[batch_size + 64];
+    size_t semi_cnt = 0;
+    size_t nl_cnt = 0;
+    size_t line_begin = 0;
+    // Offsets of the blocks with suspicious bytes that aren't processed yet
+    std::vector<uint64_t> suspicious;
+    Batch batch;
+
+    // Validate and record the next "lines" lines, returns the number of
+    // semicolons that belong to them
+    auto process_batch = [&](size_t lines) {
+        size_t end = newlines[lines - 1];
+        bool valid = semi_cnt >= lines;
+        if (valid) {
+            uint64_t next = semi_cnt > lines ? semicolons[lines] : UINT64_MAX;
+            valid = valid_batch(base, line_begin, semicolons, newlines, lines,
+                                next, file_end);
+        }
+        if (valid && not suspicious.empty() && suspicious.front() <= end)
+            valid = valid_bytes(base + line_begin, base + end);
+        while (not suspicious.empty() && suspicious.front() + 64 <= end + 1)
+            suspicious.erase(suspicious.begin());
+
+        if (valid) {
+            decode_batch(batch, base, line_begin, semicolons, newlines, lines,
+                         file_end);
+            db.record_batch(batch, lines);
+            report.lines += lines;
+            line_begin = end + 1;
+            return lines;
+        }
+        parse_careful(db, base + line_begin, base + end + 1, file.data(),
+                      file_end, report, rejected);
+        line_begin = end + 1;
+        return size_t(std::ranges::lower_bound(semicolons,
+                                               semicolons + semi_cnt,
+                                               line_begin) -
+                      semicolons);
+    };
+
+    for (size_t offset = 0; offset < size; offset += 64) {
+        BlockMasks masks;
+        if (base + offset + 64 <= file_end) {
+            masks = scan_block(base + offset);
+        } else {
+            // The last block of the file, scan a zero padded copy
+            alignas(64) char tail[64] = {};
+            memcpy(tail, base + offset, file_end - (base + offset));
+            masks = scan_block(tail);
+            masks.suspicious &= low_bytes(file_end - (base + offset));
+        }
+        // Ignore anything past the end of the chunk
+        if (size - offset < 64) {
+            uint64_t valid = (uint64_t{1} << (size - offset)) - 1;
+            masks.semicolons &= valid;
+            masks.newlines &= valid;
+            masks.suspicious &= valid;
+        }
+
+        if (masks.suspicious != 0)
+            suspicious.push_back(offset);
+        for (uint64_t m = masks.semicolons; m != 0; m &= m - 1)
+            semicolons[semi_cnt++] = offset + std::countr_zero(m);
+        for (uint64_t m = masks.newlines; m != 0; m &= m - 1)
+            newlines[nl_cnt++] = offset + std::countr_zero(m);
+
+        // Validate and record full batches of complete lines
+        while (nl_cnt >= batch_size) {
+            size_t semis_done = process_batch(batch_size);
+            std::copy(semicolons + semis_done, semicolons + semi_cnt,
+                      semicolons);
+            std::copy(newlines + batch_size, newlines + nl_cnt, newlines);
+            semi_cnt -= semis_done;
+            nl_cnt -= batch_size;
+        }
+        // Lines with many ';' can't overflow the buffer, they go to the
+        // careful parser anyway
+        if (semi_cnt > batch_size + 64) {
+            size_t lines = nl_cnt;
+            if (lines != 0) {
+                size_t semis_done = process_batch(lines);
+                std::copy(semicolons + semis_done, semicolons + semi_cnt,
+                          semicolons);
+                semi_cnt -= semis_done;
+                nl_cnt = 0;
+            }
+            // Still too many: no newline for a while, leave it all to the
+            // careful parser at the end
+            if (semi_cnt > batch_size + 64)
+                semi_cnt = 0;
+        }
+    }
+
+    // The remaining complete lines, then a last line without newline
+    if (nl_cnt != 0)
+        process_batch(nl_cnt);
+    if (line_begin != size)
+        parse_careful(db, base + line_begin, base + size, file.data(),
+                      file_end, report, rejected);
+}
+
+// The per-thread results for one input file
+struct FileResult {
+    Report report;
+    std::vector<Rejected> rejected;
+};
+
+void process_file(MappedFile &file, std::vector<Table> &dbs,
+                  std::vector<FileResult> &results, bool keep_rejected) {
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(dbs.size());
+    for (size_t i = 0; i < dbs.size(); ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto *rejected = keep_rejected ? &results[idx].rejected : nullptr;
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input(dbs[idx], chunk, file.data(),
+                              results[idx].report, rejected);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+}
+
+std::unordered_map<std::string, Record> merge(std::vector<Table> &dbs) {
+    std::unordered_map<std::string, Record> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto &slot : db_chunk.slots_) {
+            if (slot.key.name == nullptr)
+                continue;
+            std::string name(slot.key.name, slot.key.len);
+            auto it = merged.find(name);
+            if (it == merged.end()) {
+                merged.insert_or_assign(std::move(name), slot.value);
+            } else {
+                it->second.cnt += slot.value.cnt;
+                it->second.sum += slot.value.sum;
+                it->second.max = std::max(it->second.max, slot.value.max);
+                it->second.min = std::min(it->second.min, slot.value.min);
+            }
+        }
+    }
+    return merged;
+}
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+int main(int argc, char **argv) try {
+    // Usage: 20_tolerant [threads] [chunk_mb] [--input=FILE]... [--report]
+    //                    [--quarantine=FILE]
+    //
+    // Clean batches take the fast path of 13_batch_parse.cpp, the rest is
+    // parsed line by line: CRLF line endings, empty lines and values with
+    // more decimals are accepted, lines that can't be parsed (bad UTF-8,
+    // control characters, names over 100 bytes, missing or extra ';', bad
+    // values) are skipped and counted. The per-file report goes to stderr
+    // with --report or if there were rejected lines, --quarantine writes the
+    // rejected lines as "file:offset: line".
+    size_t threads = 1;
+    size_t chunk_mb = 64;
+    std::vector<std::filesystem::path> inputs;
+    bool show_report = false;
+    std::filesystem::path quarantine;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--input="))
+            inputs.emplace_back(arg.substr(arg.find('=') + 1));
+        else if (arg == "--report")
+            show_report = true;
+        else if (arg.starts_with("--quarantine="))
+            quarantine = arg.substr(arg.find('=') + 1);
+        else if (pos++ == 0)
+            threads = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    if (inputs.empty())
+        inputs.emplace_back("measurements.txt");
+
+    std::ofstream quarantine_out;
+    if (not quarantine.empty()) {
+        quarantine_out.open(quarantine);
+        if (not quarantine_out)
+            throw std::runtime_error("Failed to open " + quarantine.string());
+    }
+
+    // The tables point into the mapped files, they have to stay mapped until
+    // the output is done
+    std::list<MappedFile> files;
+    std::vector<Table> dbs(threads);
+    for (auto &input : inputs) {
+        auto &mfile = files.emplace_back(input, chunk_mb * 1024 * 1024);
+        std::vector<FileResult> results(threads);
+        process_file(mfile, dbs, results, not quarantine.empty());
+
+        Report report;
+        std::vector<Rejected> rejected;
+        for (auto &result : results) {
+            report += result.report;
+            std::ranges::move(result.rejected, std::back_inserter(rejected));
+        }
+        if (show_report || report.rejected != 0)
+            std::cerr << input.string() << ": " << report.lines << " lines, "
+                      << report.lines - report.careful << " fast, "
+                      << report.careful << " careful, " << report.repaired
+                      << " repaired, " << report.empty << " empty, "
+                      << report.rejected << " rejected\n";
+        std::ranges::sort(rejected, {}, &Rejected::offset);
+        for (auto &line : rejected)
+            quarantine_out << input.string() << ":" << line.offset << ": "
+                           << line.line;
+    }
+
+    auto db = merge(dbs);
+    format_output(std::cout, db);
+} catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,267 @@
+#include "schema.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+
+template <typename S> struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Row<S> &row) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(row);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = row.name;
+            values_[slot] = Record<S>::init(row);
+            return;
+        }
+
+        // Otherwise we have a hit
+        values_[slot].update(row);
+    }
+
+    size_t lookup_slot(const Row<S> &row) const {
+        uint16_t slot = row.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == row.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record<S>, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+template <typename S>
+void process_input(DB<S> &db, std::span<const char> data) {
+    const char *ptr = data.data();
+    const char *end = data.data() + data.size();
+
+    while (ptr != end)
+        db.record(parse<S>(ptr));
+}
+
+template <typename S>
+using Results = std::unordered_map<std::string, Record<S>>;
+
+template <typename S>
+Results<S> process_parallel(MappedFile &file, size_t chunks) {
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::vector<DB<S>> dbs(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input(dbs[idx], chunk);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+
+    // Merge the partial DBs
+    Results<S> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk.filled_) {
+            auto it = merged.find(db_chunk.keys_[idx]);
+            if (it == merged.end())
+                merged.insert_or_assign(db_chunk.keys_[idx],
+                                        db_chunk.values_[idx]);
+            else
+                it->second.merge(db_chunk.values_[idx]);
+        }
+    }
+    return merged;
+}
+
+template <typename S> void format_output(std::ostream &out, Results<S> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint);
+    out << "{";
+    for (auto &name : names) {
+        out << std::exchange(delim, ", ") << name << "=";
+        db[name].format(out);
+    }
+    out << "}\n";
+}
+
+template <typename S> void run(MappedFile &mfile, size_t chunks) {
+    auto db = process_parallel<S>(mfile, chunks);
+    format_output<S>(std::cout, db);
+}
+
+// The feeds we know about, each one is a separate instantiation of the engine
+using Measurements = Schema<';', 0, FixedPoint<1, 1>>;
+// station;temp;humidity;pressure
+using Weather =
+    Schema<';', 0, FixedPoint<1, 1>, FixedPoint<2, 1>, FixedPoint<3, 1>>;
+// station,temp with two decimals
+using Csv = Schema<',', 0, FixedPoint<1, 2>>;
+using Tsv = Schema<'\t', 0, FixedPoint<1, 1>>;
+
+int main(int argc, char **argv) {
+    // Usage: 21_schema [threads] [chunk_mb] [--schema=name] [--input=FILE]
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    std::string_view schema = "measurements";
+    std::filesystem::path input = "measurements.txt";
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--schema="))
+            schema = arg.substr(arg.find('=') + 1);
+        else if (arg.starts_with("--input="))
+            input = arg.substr(arg.find('=') + 1);
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile(input, chunk_mb * 1024 * 1024);
+
+    if (schema == "measurements")
+        run<Measurements>(mfile, chunks);
+    else if (schema == "weather")
+        run<Weather>(mfile, chunks);
+    else if (schema == "csv")
+        run<Csv>(mfile, chunks);
+    else if (schema == "tsv")
+        run<Tsv>(mfile, chunks);
+    else {
+        std::cerr << "Unknown schema: " << schema << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+
+// The dispenser of 09_dynamic_chunks.cpp hands out the chunks in file order.
+// For sampling, the file is cut into fixed chunks up front (aligned to the
+// line starts the same way) and they are handed out in a random order. The
+// order is a permutation, so every prefix of it is a simple random sample of
+// the chunks, and taking more chunks only extends the sample.
+class SampledChunks {
+  public:
+    SampledChunks(std::span<const char> data, size_t chunk_sz, uint64_t seed)
+        : data_(data), chunk_sz_(chunk_sz),
+          order_((data.size() + chunk_sz - 1) / chunk_sz) {
+        std::iota(order_.begin(), order_.end(), 0);
+        std::mt19937_64 rng(seed);
+        std::ranges::shuffle(order_, rng);
+    }
+
+    size_t count() const { return order_.size(); }
+
+    // Hand out chunks until "limit" chunks of the order are taken. A chunk
+    // can be empty if a single line spans it.
+    std::optional<std::span<const char>> next_chunk(size_t limit) {
+        size_t idx = next_.fetch_add(1, std::memory_order_relaxed);
+        if (idx >= std::min(limit, order_.size())) {
+            next_.fetch_sub(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        taken_.fetch_add(1, std::memory_order_relaxed);
+        size_t chunk = order_[idx];
+        return data_.subspan(align(chunk * chunk_sz_),
+                             align((chunk + 1) * chunk_sz_) -
+                                 align(chunk * chunk_sz_));
+    }
+
+    // The number of chunks handed out so far
+    size_t taken() const { return taken_.load(std::memory_order_relaxed); }
+
+  private:
+    // The start of the first line that begins at or after "pos"
+    size_t align(size_t pos) const {
+        if (pos == 0 || pos >= data_.size())
+            return std::min(pos, data_.size());
+        auto it = std::ranges::find(data_.subspan(pos - 1), '\n');
+        return std::min<size_t>(it - data_.begin() + 1, data_.size());
+    }
+
+    std::span<const char> data_;
+    size_t chunk_sz_;
+    std::vector<size_t> order_;
+    std::atomic<size_t> next_ = 0;
+    std::atomic<size_t> taken_ = 0;
+};
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    // The rows of the current chunk, folded into Moments after each chunk
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+// Per station sums over the sampled chunks. With the per-chunk counts c_i and
+// sums s_i, the mean is the ratio estimator sum(s_i) / sum(c_i), and its
+// variance needs the second moments of c_i and s_i.
+struct Moments {
+    // Sampled chunks with rows of this station
+    int64_t chunks = 0;
+    int64_t cnt = 0;
+    int64_t sum = 0;
+    double cnt_sq = 0;
+    double sum_sq = 0;
+    double sum_cnt = 0;
+
+    int16_t min = INT16_MAX;
+    int16_t max = INT16_MIN;
+
+    void add(const Record &chunk) {
+        ++chunks;
+        cnt += chunk.cnt;
+        sum += chunk.sum;
+        cnt_sq += double(chunk.cnt) * chunk.cnt;
+        sum_sq += double(chunk.sum) * chunk.sum;
+        sum_cnt += double(chunk.sum) * chunk.cnt;
+        min = std::min(min, chunk.min);
+        max = std::max(max, chunk.max);
+    }
+
+    void merge(const Moments &other) {
+        chunks += other.chunks;
+        cnt += other.cnt;
+        sum += other.sum;
+        cnt_sq += other.cnt_sq;
+        sum_sq += other.sum_sq;
+        sum_cnt += other.sum_cnt;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, moments_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            touched_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit, maybe the first one in this chunk
+        if (values_[slot].cnt == 0)
+            touched_.push_back(slot);
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Fold the counts of the finished chunk into the moments
+    void end_chunk() {
+        for (auto slot : touched_) {
+            moments_[slot].add(values_[slot]);
+            values_[slot].cnt = 0;
+            values_[slot].sum = 0;
+        }
+        touched_.clear();
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    std::array<Moments, UINT16_MAX + 1> moments_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+    // The slots with rows in the current chunk
+    std::vector<size_t> touched_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+    db.end_chunk();
+}
+
+using Clock = std::chrono::steady_clock;
+
+// Process the chunks of the order up to "limit", or until the deadline
+void process_parallel(SampledChunks &chunks, std::span<DB> dbs, size_t limit,
+                      Clock::time_point deadline) {
+    std::vector<std::jthread> runners(dbs.size());
+    for (size_t i = 0; i < dbs.size(); ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            while (Clock::now() < deadline) {
+                auto chunk = chunks.next_chunk(limit);
+                if (not chunk)
+                    break;
+                process_input(dbs[idx], *chunk);
+            }
+        });
+    }
+    runners.clear(); // join threads
+}
+
+using Results = std::unordered_map<std::string, Moments>;
+
+// Merge the partial DBs
+Results merge(std::span<const DB> dbs) {
+    Results merged;
+    for (auto &db_chunk : dbs)
+        for (auto idx : db_chunk.filled_)
+            merged[db_chunk.keys_[idx]].merge(db_chunk.moments_[idx]);
+    return merged;
+}
+
+// 95% confidence intervals
+static constexpr double z = 1.96;
+
+struct Estimate {
+    double mean;
+    double mean_err;
+    double count;
+    double count_err;
+};
+
+// Cluster sampling of "sampled" out of "total" chunks, with the finite
+// population correction: once all chunks are sampled the error is zero.
+static Estimate estimate(const Moments &m, size_t sampled, size_t total) {
+    double n = sampled;
+    double f = n / total;
+    double mean_cnt = m.cnt / n;
+    double ratio = double(m.sum) / m.cnt;
+    Estimate result{ratio / 10, 0, mean_cnt * total, 0};
+    if (sampled == total)
+        return result;
+    if (sampled < 2)
+        return {result.mean, INFINITY, result.count, INFINITY};
+
+    double ratio_var = (m.sum_sq - 2 * ratio * m.sum_cnt +
+                        ratio * ratio * m.cnt_sq) /
+                       (n - 1);
+    double cnt_var = (m.cnt_sq - n * mean_cnt * mean_cnt) / (n - 1);
+    // The variance of the mean comes from the differences between chunks.
+    // With the rows of a station in a single sampled chunk there is nothing
+    // to estimate it from, it would come out as exactly 0.
+    if (m.chunks < 2)
+        result.mean_err = INFINITY;
+    else
+        result.mean_err = z * std::sqrt(std::max(ratio_var, 0.0) * (1 - f) /
+                                        n) /
+                          mean_cnt / 10;
+    result.count_err =
+        z * total * std::sqrt(std::max(cnt_var, 0.0) * (1 - f) / n);
+    return result;
+}
+
+// The widest confidence interval of the mean over all stations
+static double worst_error(const Results &db, size_t sampled, size_t total) {
+    double worst = 0;
+    for (auto &[name, m] : db)
+        worst = std::max(worst, estimate(m, sampled, total).mean_err);
+    return worst;
+}
+
+static std::vector<std::string> sorted_names(const Results &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+    return names;
+}
+
+// All chunks were processed, the same output as 09_dynamic_chunks.cpp
+void format_output(std::ostream &out, Results &db) {
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : sorted_names(db)) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+// A sample: "name=<=min/mean±err/>=max count=cnt±err". The sampled minimum
+// is an upper bound of the true minimum and the sampled maximum is a lower
+// bound of the true maximum. An error that can't be estimated is "n/a".
+void format_estimates(std::ostream &out, Results &db, size_t sampled,
+                      size_t total) {
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint);
+    out << "{";
+    for (auto &name : sorted_names(db)) {
+        auto &value = db[name];
+        auto est = estimate(value, sampled, total);
+        out << std::exchange(delim, ", ") << name << "=<="
+            << std::setprecision(1) << value.min / 10.0 << "/" << est.mean
+            << "±";
+        if (std::isfinite(est.mean_err))
+            out << std::setprecision(2) << est.mean_err;
+        else
+            out << "n/a";
+        out << "/>=" << std::setprecision(1) << value.max / 10.0
+            << " count=" << std::llround(est.count) << "±";
+        if (std::isfinite(est.count_err))
+            out << std::llround(est.count_err);
+        else
+            out << "n/a";
+    }
+    out << "}\n";
+}
+
+int main(int argc, char **argv) {
+    // Usage: 22_sampling [threads] [chunk_mb] [--fraction=F] [--error=E]
+    //                    [--time-ms=T] [--seed=S]
+    //
+    // Processes a random fraction F of the chunks (default 0.1), then keeps
+    // adding another F until the 95% confidence interval of every station
+    // mean is within ±E °C, or the time budget is used up. Without --error
+    // and --time-ms only the first fraction is processed. Once all chunks
+    // are processed the output is exact.
+    size_t threads = 1;
+    size_t chunk_mb = 1;
+    double fraction = 0.1;
+    std::optional<double> error;
+    std::optional<std::chrono::milliseconds> budget;
+    uint64_t seed = std::random_device{}();
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = std::string(arg.substr(arg.find('=') + 1));
+        if (arg.starts_with("--fraction="))
+            fraction = std::stod(value);
+        else if (arg.starts_with("--error="))
+            error = std::stod(value);
+        else if (arg.starts_with("--time-ms="))
+            budget = std::chrono::milliseconds(std::stol(value));
+        else if (arg.starts_with("--seed="))
+            seed = std::stoull(value);
+        else if (pos++ == 0)
+            threads = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    auto start = Clock::now();
+    auto deadline = budget ? start + *budget : Clock::time_point::max();
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+    SampledChunks chunks(mfile.data(), chunk_mb * 1024 * 1024, seed);
+
+    size_t total = chunks.count();
+    size_t step = std::clamp<size_t>(std::ceil(fraction * total), 1, total);
+    std::vector<DB> dbs(threads);
+    Results db;
+    double worst = INFINITY;
+    for (size_t limit = step;; limit += step) {
+        process_parallel(chunks, dbs, limit, deadline);
+        db = merge(dbs);
+        worst = worst_error(db, chunks.taken(), total);
+        if (chunks.taken() == total || not(error || budget) ||
+            (error && worst <= *error) || Clock::now() >= deadline)
+            break;
+    }
+
+    size_t sampled = chunks.taken();
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    std::cerr << "Sampled " << sampled << " of " << total << " chunks in "
+              << elapsed.count() << " ms, mean within ±" << worst << "\n";
+    if (sampled == total)
+        format_output(std::cout, db);
+    else
+        format_estimates(std::cout, db, sampled, total);
+}
@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+using Results = std::unordered_map<std::string, Record>;
+
+void merge_into(Results &merged, const std::string &name,
+                const Record &value) {
+    auto it = merged.find(name);
+    if (it == merged.end()) {
+        merged.insert_or_assign(name, value);
+    } else {
+        it->second.cnt += value.cnt;
+        it->second.sum += value.sum;
+        it->second.max = std::max(it->second.max, value.max);
+        it->second.min = std::min(it->second.min, value.min);
+    }
+}
+
+// Online aggregation
+//
+// The workers run exactly like in 09_dynamic_chunks.cpp. To get a partial
+// result, the reporter bumps the requested epoch. Each worker checks it
+// between chunks, copies the used slots of its table (the values only, the
+// names in the slots never change once set) and publishes the copy. The
+// snapshot of a worker is therefore consistent: it covers exactly the chunks
+// the worker finished. The workers never wait for the reporter, and the
+// reporter only waits for the workers to reach the end of their current
+// chunk.
+struct Worker {
+    DB db;
+    // Bytes of the finished chunks, only used by the worker
+    size_t bytes = 0;
+
+    // Guarded by Online::mux
+    uint64_t epoch = 0;
+    bool done = false;
+    size_t snapshot_bytes = 0;
+    std::vector<std::pair<size_t, Record>> snapshot;
+};
+
+struct Online {
+    explicit Online(size_t threads) : workers(threads) {}
+
+    std::vector<Worker> workers;
+    std::atomic<uint64_t> requested = 0;
+    // Bytes of all finished chunks, for the size based reporting
+    std::atomic<size_t> progress = 0;
+
+    std::mutex mux;
+    std::condition_variable published;
+    std::condition_variable wake_reporter;
+    size_t done = 0;
+};
+
+void publish(Online &online, Worker &worker, uint64_t epoch) {
+    std::vector<std::pair<size_t, Record>> snapshot;
+    snapshot.reserve(worker.db.filled_.size());
+    for (auto idx : worker.db.filled_)
+        snapshot.emplace_back(idx, worker.db.values_[idx]);
+    {
+        std::lock_guard lock{online.mux};
+        worker.snapshot = std::move(snapshot);
+        worker.snapshot_bytes = worker.bytes;
+        worker.epoch = epoch;
+    }
+    online.published.notify_all();
+}
+
+void run_worker(Online &online, Worker &worker, MappedFile &file) {
+    uint64_t epoch = 0;
+    auto chunk = file.next_chunk();
+    while (not chunk.empty()) {
+        process_input(worker.db, chunk);
+        worker.bytes += chunk.size();
+        online.progress.fetch_add(chunk.size(), std::memory_order_relaxed);
+        online.wake_reporter.notify_one();
+
+        if (online.requested.load(std::memory_order_acquire) != epoch) {
+            epoch = online.requested.load(std::memory_order_acquire);
+            publish(online, worker, epoch);
+        }
+        chunk = file.next_chunk();
+    }
+
+    // The table doesn't change anymore, the reporter can read it directly
+    {
+        std::lock_guard lock{online.mux};
+        worker.done = true;
+        ++online.done;
+    }
+    online.published.notify_all();
+    online.wake_reporter.notify_one();
+}
+
+// Request a snapshot from all workers and merge it, returns the merged
+// partial result and the number of bytes it covers
+std::pair<Results, size_t> take_snapshot(Online &online, uint64_t epoch) {
+    online.requested.store(epoch, std::memory_order_release);
+
+    std::unique_lock lock{online.mux};
+    online.published.wait(lock, [&] {
+        return std::ranges::all_of(online.workers, [&](const Worker &w) {
+            return w.done || w.epoch == epoch;
+        });
+    });
+
+    Results merged;
+    size_t bytes = 0;
+    for (auto &worker : online.workers) {
+        if (worker.done) {
+            for (auto idx : worker.db.filled_)
+                merge_into(merged, worker.db.keys_[idx],
+                           worker.db.values_[idx]);
+            bytes += worker.bytes;
+        } else {
+            for (auto &[idx, value] : worker.snapshot)
+                merge_into(merged, worker.db.keys_[idx], value);
+            bytes += worker.snapshot_bytes;
+        }
+    }
+    return {std::move(merged), bytes};
+}
+
+void format_output(std::ostream &out, Results &db);
+
+// Emit a partial result every "interval" or every "step" bytes, whichever
+// comes first, until all workers are done
+void run_reporter(Online &online, size_t file_size,
+                  std::chrono::duration<double> interval, size_t step) {
+    using Clock = std::chrono::steady_clock;
+    auto next_time = Clock::now() + interval;
+    size_t next_bytes = step;
+    for (uint64_t epoch = 1;; ++epoch) {
+        {
+            // The workers notify without the lock, a missed wakeup only
+            // delays the report to the end of the next chunk
+            std::unique_lock lock{online.mux};
+            online.wake_reporter.wait_until(
+                lock,
+                std::chrono::time_point_cast<Clock::duration>(next_time),
+                [&] {
+                    return online.done == online.workers.size() ||
+                           online.progress.load(std::memory_order_relaxed) >=
+                               next_bytes;
+                });
+            if (online.done == online.workers.size())
+                return;
+        }
+
+        auto [partial, bytes] = take_snapshot(online, epoch);
+        std::cerr << std::fixed << std::setprecision(1) << "["
+                  << 100.0 * bytes / file_size << "%] ";
+        format_output(std::cerr, partial);
+
+        next_time = Clock::now() + interval;
+        while (next_bytes <= online.progress.load(std::memory_order_relaxed))
+            next_bytes += step;
+    }
+}
+
+Results process_online(MappedFile &file, size_t threads,
+                       std::chrono::duration<double> interval, size_t step) {
+    Online online(threads);
+    std::jthread reporter([&] {
+        run_reporter(online, file.data().size(), interval, step);
+    });
+
+    std::vector<std::jthread> runners(threads);
+    for (size_t i = 0; i < threads; ++i)
+        runners[i] = std::jthread(
+            [&, idx = i]() { run_worker(online, online.workers[idx], file); });
+    runners.clear(); // join threads
+    reporter.join();
+
+    // Merge the partial DBs
+    Results merged;
+    for (auto &worker : online.workers)
+        for (auto idx : worker.db.filled_)
+            merge_into(merged, worker.db.keys_[idx], worker.db.values_[idx]);
+    return merged;
+}
+
+void format_output(std::ostream &out, Results &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+int main(int argc, char **argv) {
+    // Usage: 23_online [threads] [chunk_mb] [--every-s=S] [--every-gb=G]
+    //
+    // The partial results go to stderr, prefixed with the progress. The
+    // final result on stdout is the same as for 09_dynamic_chunks.cpp.
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    double every_s = 1;
+    double every_gb = 0;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = std::string(arg.substr(arg.find('=') + 1));
+        if (arg.starts_with("--every-s="))
+            every_s = std::stod(value);
+        else if (arg.starts_with("--every-gb="))
+            every_gb = std::stod(value);
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    // Zero disables either trigger
+    std::chrono::duration<double> interval =
+        every_s > 0 ? std::chrono::duration<double>(every_s)
+                    : std::chrono::hours(24 * 365);
+    size_t step = every_gb > 0 ? size_t(every_gb * (1 << 30)) : SIZE_MAX;
+    auto db = process_online(mfile, chunks, interval, step);
+    format_output(std::cout, db);
+}
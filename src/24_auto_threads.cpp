@@ -0,0 +1,553 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <pthread.h>
+#include <ranges>
+#include <sched.h>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() { return next_chunk(chunk_sz_); }
+
+    std::span<const char> next_chunk(size_t chunk_sz) {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+// Automatic thread count
+//
+// hardware_concurrency() counts the CPUs of the machine, not the ones this
+// process may use. The usable CPUs are limited by the affinity mask (e.g.
+// cpusets, taskset) and by the cgroup v2 CPU quota (e.g. the CPU limit of a
+// Kubernetes pod), running more threads than the quota allows only gets the
+// process throttled. Within those limits, one thread per physical core is
+// the safe choice. Whether the SMT siblings add anything depends on the
+// machine and the data, so that is measured: a short probe on the first
+// chunks runs with one thread per core and with all the CPUs, and the faster
+// one processes the rest of the file.
+
+// Parse a CPU list like "0-3,8,10-11"
+static std::vector<int> parse_cpu_list(std::string_view list) {
+    std::vector<int> cpus;
+    while (not list.empty()) {
+        auto item = list.substr(0, list.find(','));
+        list.remove_prefix(std::min(item.size() + 1, list.size()));
+        int first = 0;
+        int last = 0;
+        auto [ptr, ec] =
+            std::from_chars(item.data(), item.data() + item.size(), first);
+        if (ec != std::errc{})
+            break;
+        last = first;
+        if (ptr != item.data() + item.size() && *ptr == '-')
+            std::from_chars(ptr + 1, item.data() + item.size(), last);
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+static std::optional<std::string> read_line(const std::filesystem::path &path) {
+    std::ifstream in(path);
+    std::string line;
+    if (not std::getline(in, line))
+        return std::nullopt;
+    return line;
+}
+
+static std::vector<int> allowed_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<int> cpus;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+    }
+    if (cpus.empty())
+        for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu)
+            cpus.push_back(cpu);
+    return cpus;
+}
+
+// The lowest CPU of the physical core, identifies the core
+static int core_of(int cpu) {
+    auto siblings = read_line("/sys/devices/system/cpu/cpu" +
+                              std::to_string(cpu) +
+                              "/topology/thread_siblings_list");
+    if (not siblings)
+        return cpu;
+    auto list = parse_cpu_list(*siblings);
+    return list.empty() ? cpu : std::ranges::min(list);
+}
+
+// The cgroup v2 CPU quota in CPUs, the smallest one on the path from the
+// cgroup of this process to the root
+static std::optional<double> cgroup_quota() {
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+    std::optional<std::filesystem::path> cgroup;
+    while (std::getline(in, line))
+        if (line.starts_with("0::"))
+            cgroup = line.substr(3);
+    if (not cgroup)
+        return std::nullopt;
+
+    std::optional<double> quota;
+    for (auto path = *cgroup;; path = path.parent_path()) {
+        auto cpu_max = read_line(std::filesystem::path("/sys/fs/cgroup") /
+                                 path.relative_path() / "cpu.max");
+        // "max 100000" or "<quota> <period>" in microseconds
+        if (cpu_max && not cpu_max->starts_with("max")) {
+            double max = 0;
+            double period = 0;
+            if (std::istringstream(*cpu_max) >> max >> period && period > 0)
+                quota = std::min(quota.value_or(max / period), max / period);
+        }
+        if (path == path.parent_path() || path.empty())
+            break;
+    }
+    return quota;
+}
+
+struct Topology {
+    // The usable CPUs in placement order: the first CPU of every core, then
+    // the second ones and so on
+    std::vector<int> cpus;
+    size_t cores = 0;
+    std::optional<double> quota;
+    // The most threads worth running
+    size_t limit = 1;
+};
+
+static Topology detect_topology() {
+    Topology topo;
+    std::map<int, std::vector<int>> cores;
+    for (int cpu : allowed_cpus())
+        cores[core_of(cpu)].push_back(cpu);
+    topo.cores = cores.size();
+    for (size_t rank = 0; topo.cpus.size() < cores.size() * 8; ++rank) {
+        size_t before = topo.cpus.size();
+        for (auto &[core, cpus] : cores)
+            if (rank < cpus.size())
+                topo.cpus.push_back(cpus[rank]);
+        if (topo.cpus.size() == before)
+            break;
+    }
+
+    topo.quota = cgroup_quota();
+    topo.limit = topo.cpus.size();
+    if (topo.quota)
+        topo.limit = std::clamp<size_t>(std::ceil(*topo.quota), 1, topo.limit);
+    return topo;
+}
+
+static void pin_to(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // Best effort, the thread just isn't pinned on failure
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Process the chunks with one thread per DB, pinned to "cpus" unless that is
+// empty. Every thread takes at most "max_chunks" chunks of "chunk_sz" bytes,
+// returns the number of bytes processed.
+size_t process_chunks(MappedFile &file, std::span<DB> dbs,
+                      std::span<const int> cpus, size_t chunk_sz,
+                      size_t max_chunks = SIZE_MAX) {
+    std::atomic<size_t> bytes = 0;
+    std::vector<std::jthread> runners(dbs.size());
+    for (size_t i = 0; i < dbs.size(); ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            if (not cpus.empty())
+                pin_to(cpus[idx]);
+            size_t processed = 0;
+            for (size_t cnt = 0; cnt < max_chunks; ++cnt) {
+                auto chunk = file.next_chunk(chunk_sz);
+                if (chunk.empty())
+                    break;
+                process_input(dbs[idx], chunk);
+                processed += chunk.size();
+            }
+            bytes += processed;
+        });
+    }
+    runners.clear(); // join threads
+    return bytes;
+}
+
+// Bytes per second of processing a few small chunks per thread
+static double probe(MappedFile &file, std::span<DB> dbs,
+                    std::span<const int> cpus) {
+    constexpr size_t probe_chunk = 1024 * 1024;
+    constexpr size_t probe_chunks = 2;
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = process_chunks(file, dbs, cpus, probe_chunk, probe_chunks);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return bytes / elapsed.count();
+}
+
+// Merge the partial DBs
+std::unordered_map<std::string, Record> merge(std::span<const DB> dbs) {
+    std::unordered_map<std::string, Record> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk.filled_) {
+            auto it = merged.find(db_chunk.keys_[idx]);
+            if (it == merged.end()) {
+                merged.insert_or_assign(db_chunk.keys_[idx],
+                                        db_chunk.values_[idx]);
+            } else {
+                it->second.cnt += db_chunk.values_[idx].cnt;
+                it->second.sum += db_chunk.values_[idx].sum;
+                it->second.max =
+                    std::max(it->second.max, db_chunk.values_[idx].max);
+                it->second.min =
+                    std::min(it->second.min, db_chunk.values_[idx].min);
+            }
+        }
+    }
+    return merged;
+}
+
+std::unordered_map<std::string, Record>
+process_auto(MappedFile &file, size_t chunk_sz, bool verbose) {
+    Topology topo = detect_topology();
+    size_t per_core = std::min(topo.cores, topo.limit);
+    size_t threads = per_core;
+    std::vector<DB> dbs(topo.limit);
+    std::span<const int> cpus = topo.cpus;
+
+    if (verbose) {
+        std::cerr << "usable CPUs: " << topo.cpus.size()
+                  << ", cores: " << topo.cores << ", quota: ";
+        if (topo.quota)
+            std::cerr << *topo.quota;
+        else
+            std::cerr << "none";
+        std::cerr << ", limit: " << topo.limit << "\n";
+    }
+
+    // Only worth a probe if there are SMT siblings within the limit. The two
+    // configurations run twice, alternating, so that neither one pays alone
+    // for the first touch of the table and the input.
+    if (topo.limit > per_core) {
+        double core_rate = 0;
+        double smt_rate = 0;
+        for (size_t round = 0; round < 2; ++round) {
+            core_rate = std::max(
+                core_rate, probe(file, std::span(dbs).first(per_core),
+                                 cpus.first(per_core)));
+            smt_rate = std::max(smt_rate, probe(file, dbs, cpus));
+        }
+        // The siblings have to pay for the extra table and merge
+        if (smt_rate > core_rate * 1.05)
+            threads = topo.limit;
+        if (verbose)
+            std::cerr << "probe: " << per_core << " threads "
+                      << core_rate / 1e9 << " GB/s, " << topo.limit
+                      << " threads " << smt_rate / 1e9 << " GB/s\n";
+    }
+    if (verbose) {
+        std::cerr << "threads: " << threads << ", CPUs:";
+        for (int cpu : cpus.first(threads))
+            std::cerr << " " << cpu;
+        std::cerr << "\n";
+    }
+
+    process_chunks(file, std::span(dbs).first(threads), cpus.first(threads),
+                   chunk_sz);
+    return merge(dbs);
+}
+
+std::unordered_map<std::string, Record> process_parallel(MappedFile &file,
+                                                         size_t chunks,
+                                                         size_t chunk_sz) {
+    std::vector<DB> dbs(chunks);
+    process_chunks(file, dbs, {}, chunk_sz);
+    return merge(dbs);
+}
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+int main(int argc, char **argv) {
+    // Usage: 24_auto_threads [threads] [chunk_mb] [--plan]
+    //
+    // Without a thread count (or with 0) the threads are sized and pinned
+    // automatically, --plan prints the decision to stderr.
+    size_t chunks = 0;
+    size_t chunk_mb = 64;
+    bool verbose = false;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--plan")
+            verbose = true;
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    size_t chunk_sz = chunk_mb * 1024 * 1024;
+    MappedFile mfile("measurements.txt", chunk_sz);
+
+    auto db = chunks == 0 ? process_auto(mfile, chunk_sz, verbose)
+                          : process_parallel(mfile, chunks, chunk_sz);
+    format_output(std::cout, db);
+}
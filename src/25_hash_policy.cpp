@@ -0,0 +1,557 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <functional>
+#include <immintrin.h>
+#include <iomanip>
+#include <iostream>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+// Hash policies
+//
+// A policy hashes the station name, the table uses the low 16 bits of the
+// result as the home slot. Incremental policies are updated byte by byte
+// while scanning for the ';' (like the original hash in parse()), the others
+// hash the whole name once the ';' is found, reading it as 8 byte words.
+
+// The hash from 09_dynamic_chunks.cpp
+struct Poly7 {
+    static constexpr std::string_view name = "poly7";
+    static constexpr bool incremental = true;
+    static uint64_t step(uint64_t hash, char c) { return hash * 7 + c; }
+};
+
+// The hash from 06_custom_hash.cpp and parse_v2()
+struct StdHash {
+    static constexpr std::string_view name = "std";
+    static constexpr bool incremental = false;
+    static uint64_t hash(std::string_view name, const char *) {
+        return std::hash<std::string_view>{}(name);
+    }
+};
+
+static uint64_t load_word(const char *ptr) {
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+// Call fn(word) for the name as 8 byte words, the last one zero padded. The
+// words can be read past the name as long as they stay before "end".
+template <typename Fn>
+static void for_each_word(std::string_view name, const char *end, Fn &&fn) {
+    const char *ptr = name.data();
+    size_t len = name.size();
+    for (; len >= 8; ptr += 8, len -= 8)
+        fn(load_word(ptr));
+    if (len == 0)
+        return;
+    if (ptr + 8 <= end) {
+        fn(load_word(ptr) & ((uint64_t{1} << (len * 8)) - 1));
+    } else {
+        uint64_t word = 0;
+        memcpy(&word, ptr, len);
+        fn(word);
+    }
+}
+
+// Multiply-shift over the words, the top bits of the product are the well
+// mixed ones
+struct MultiplyShift {
+    static constexpr std::string_view name = "multiply-shift";
+    static constexpr bool incremental = false;
+    static uint64_t hash(std::string_view name, const char *end) {
+        uint64_t hash = name.size();
+        for_each_word(name, end, [&](uint64_t word) {
+            hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+        });
+        return hash >> 48;
+    }
+};
+
+// CRC32C with the SSE 4.2 instruction, one word per cycle throughput. The
+// instruction isn't part of the x86-64 baseline, the processing loop for this
+// policy is compiled with the target attribute (see process_input below).
+struct Crc32c {
+    static constexpr std::string_view name = "crc32c";
+    static constexpr bool incremental = false;
+    [[gnu::target("sse4.2")]] static uint64_t hash(std::string_view name,
+                                                   const char *end) {
+        // No for_each_word(), the lambda wouldn't have the target attribute
+        const char *ptr = name.data();
+        size_t len = name.size();
+        uint64_t crc = len;
+        for (; len >= 8; ptr += 8, len -= 8)
+            crc = _mm_crc32_u64(crc, load_word(ptr));
+        if (len != 0) {
+            uint64_t word = 0;
+            if (ptr + 8 <= end)
+                word = load_word(ptr) & ((uint64_t{1} << (len * 8)) - 1);
+            else
+                memcpy(&word, ptr, len);
+            crc = _mm_crc32_u64(crc, word);
+        }
+        return crc;
+    }
+};
+
+// wyhash style mixing: a 64x64 -> 128 bit multiply folded back to 64 bits
+struct WyHash {
+    static constexpr std::string_view name = "wyhash";
+    static constexpr bool incremental = false;
+
+    static uint64_t mum(uint64_t a, uint64_t b) {
+        __extension__ using u128 = unsigned __int128;
+        u128 product = u128{a} * b;
+        return uint64_t(product) ^ uint64_t(product >> 64);
+    }
+
+    static uint64_t hash(std::string_view name, const char *end) {
+        uint64_t seed = name.size() ^ 0xA0761D6478BD642F;
+        for_each_word(name, end, [&](uint64_t word) {
+            seed = mum(word ^ 0xE7037ED1A0B428DB, seed ^ 0x8EBC6AF09C88C6E3);
+        });
+        return mum(seed, 0x589965CC75374CC3);
+    }
+};
+
+template <typename Hash>
+Measurement parse(std::span<const char>::iterator &iter, const char *end) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    if constexpr (Hash::incremental) {
+        uint64_t hash = 0;
+        while (*iter != ';') {
+            hash = Hash::step(hash, *iter);
+            ++iter;
+        }
+        result.hash = hash;
+        result.name = {begin, iter.base()};
+    } else {
+        while (*iter != ';')
+            ++iter;
+        result.name = {begin, iter.base()};
+        result.hash = Hash::hash(result.name, end);
+    }
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+template <typename Hash>
+inline void process_lines(DB &db, std::span<const char> data) {
+    const char *end = data.data() + data.size();
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse<Hash>(iter, end);
+
+        db.record(record);
+    }
+}
+
+template <typename Hash>
+void process_input(DB &db, std::span<const char> data) {
+    process_lines<Hash>(db, data);
+}
+
+// The whole loop with SSE 4.2, so that the CRC32C hash is inlined
+template <>
+[[gnu::target("sse4.2")]] void
+process_input<Crc32c>(DB &db, std::span<const char> data) {
+    process_lines<Crc32c>(db, data);
+}
+
+// The home slot of a station in the table
+template <typename Hash> uint16_t home_slot(std::string_view name) {
+    if constexpr (Hash::incremental) {
+        uint64_t hash = 0;
+        for (char c : name)
+            hash = Hash::step(hash, c);
+        return hash;
+    } else {
+        return Hash::hash(name, name.data() + name.size());
+    }
+}
+
+// Probe statistics of the tables, computed from the final tables after the
+// run, so there is no cost in the processing loop. Without deletions, a
+// lookup of a station probes every slot from its home slot to its actual
+// slot, so the distance is the probe length of every row of the station.
+struct ProbeStats {
+    static constexpr size_t buckets = 16;
+
+    size_t keys = 0;
+    // Keys that are not in their home slot
+    size_t displaced = 0;
+    // Keys by probe length (distance from the home slot), the last bucket
+    // collects everything longer
+    std::array<size_t, buckets + 1> histogram{};
+    uint64_t rows = 0;
+    uint64_t row_probes = 0;
+    size_t max_probe = 0;
+    // The longest run of occupied slots
+    size_t max_cluster = 0;
+
+    template <typename Hash> void add(const DB &db) {
+        for (auto idx : db.filled_) {
+            uint16_t distance = idx - home_slot<Hash>(db.keys_[idx]);
+            ++keys;
+            displaced += distance != 0;
+            ++histogram[std::min<size_t>(distance, buckets)];
+            rows += db.values_[idx].cnt;
+            row_probes += db.values_[idx].cnt * (distance + 1);
+            max_probe = std::max<size_t>(max_probe, distance);
+        }
+
+        // Start after an empty slot, the clusters wrap around
+        size_t slots = db.keys_.size();
+        size_t start = 0;
+        while (start < slots && not db.keys_[start].empty())
+            ++start;
+        size_t run = 0;
+        for (size_t i = 1; i <= slots; ++i) {
+            run = db.keys_[(start + i) % slots].empty() ? 0 : run + 1;
+            max_cluster = std::max(max_cluster, run);
+        }
+    }
+
+    void print(std::ostream &out, std::string_view hash, size_t tables) const {
+        out << "hash: " << hash << ", tables: " << tables
+            << ", keys: " << keys << "\n";
+        out << std::fixed << std::setprecision(2) << "collision rate: "
+            << 100.0 * displaced / std::max<size_t>(keys, 1)
+            << "% of keys not in their home slot\n";
+        out << "probes per row: "
+            << double(row_probes) / std::max<uint64_t>(rows, 1)
+            << ", max probe length: " << max_probe
+            << ", max cluster: " << max_cluster << "\n";
+        out << "probe length histogram:";
+        for (size_t i = 0; i <= buckets; ++i)
+            if (histogram[i] != 0)
+                out << " " << i << (i == buckets ? "+" : "") << ":"
+                    << histogram[i];
+        out << "\n";
+    }
+};
+
+template <typename Hash>
+std::unordered_map<std::string, Record>
+process_parallel(MappedFile &file, size_t chunks, bool stats) {
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::vector<DB> dbs(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input<Hash>(dbs[idx], chunk);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+
+    if (stats) {
+        ProbeStats probes;
+        for (auto &db : dbs)
+            probes.add<Hash>(db);
+        probes.print(std::cerr, Hash::name, dbs.size());
+    }
+
+    // Merge the partial DBs
+    std::unordered_map<std::string, Record> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk.filled_) {
+            auto it = merged.find(db_chunk.keys_[idx]);
+            if (it == merged.end()) {
+                merged.insert_or_assign(db_chunk.keys_[idx],
+                                        db_chunk.values_[idx]);
+            } else {
+                it->second.cnt += db_chunk.values_[idx].cnt;
+                it->second.sum += db_chunk.values_[idx].sum;
+                it->second.max =
+                    std::max(it->second.max, db_chunk.values_[idx].max);
+                it->second.min =
+                    std::min(it->second.min, db_chunk.values_[idx].min);
+            }
+        }
+    }
+    return merged;
+}
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+template <typename Hash>
+void run(MappedFile &mfile, size_t chunks, bool stats) {
+    auto db = process_parallel<Hash>(mfile, chunks, stats);
+    format_output(std::cout, db);
+}
+
+int main(int argc, char **argv) {
+    // Usage: 25_hash_policy [threads] [chunk_mb] [--hash=name] [--stats]
+    //
+    // name is one of poly7 (default), std, multiply-shift, crc32c or wyhash,
+    // --stats prints the probe statistics of the tables to stderr.
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    std::string_view hash = "poly7";
+    bool stats = false;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--hash="))
+            hash = arg.substr(arg.find('=') + 1);
+        else if (arg == "--stats")
+            stats = true;
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    // Each policy is a separate instantiation of the parser and table loop
+    if (hash == "poly7")
+        run<Poly7>(mfile, chunks, stats);
+    else if (hash == "std")
+        run<StdHash>(mfile, chunks, stats);
+    else if (hash == "multiply-shift")
+        run<MultiplyShift>(mfile, chunks, stats);
+    else if (hash == "crc32c" && __builtin_cpu_supports("sse4.2"))
+        run<Crc32c>(mfile, chunks, stats);
+    else if (hash == "wyhash")
+        run<WyHash>(mfile, chunks, stats);
+    else {
+        std::cerr << "Unknown or unsupported hash: " << hash << "\n";
+        return 1;
+    }
+}
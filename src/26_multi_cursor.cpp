@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+// Branch-light line parsing
+//
+// The byte loops of parse() end with a mispredicted branch on every line,
+// which also flushes the work of any other line in flight. For the cursors to
+// overlap, the line parser finds the ';' eight bytes at a time, hashes the
+// first and last word of the name and decodes the value without branches.
+// These loads can reach up to 8 bytes past the line, so the last lines of the
+// file are parsed byte by byte (with the same hash).
+
+static uint64_t load_word(const char *ptr) {
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+// Mask for the first "bytes" bytes of a little endian word
+static uint64_t low_bytes(size_t bytes) {
+    return bytes >= 8 ? ~uint64_t{0} : (uint64_t{1} << (bytes * 8)) - 1;
+}
+
+// High bit set in the bytes of "word" equal to ';' (exact up to the first)
+static uint64_t find_semicolon(uint64_t word) {
+    uint64_t x = word ^ 0x3B3B3B3B3B3B3B3B;
+    return (x - 0x0101010101010101) & ~x & 0x8080808080808080;
+}
+
+static uint16_t name_hash(uint64_t first, uint64_t last, size_t len) {
+    return ((first ^ std::rotl(last, 29) ^ len) * 0x9E3779B97F4A7C15) >> 48;
+}
+
+// Decode "-?d?d.d" from a single 8 byte load (merykitty's SWAR decoding),
+// "len" is the length of the value
+static int16_t decode_value(uint64_t word, size_t &len) {
+    int dot_bit = std::countr_zero(~word & 0x10101000);
+    int shift = 28 - dot_bit;
+    int64_t sign = (int64_t(~word) << 59) >> 63;
+    uint64_t design_mask = ~(sign & 0xFF);
+    uint64_t digits = ((word & design_mask) << shift) & 0x0F000F0F00;
+    uint64_t abs_value = ((digits * 0x640a0001) >> 32) & 0x3FF;
+    len = (dot_bit >> 3) + 2;
+    return int16_t((abs_value ^ sign) - sign);
+}
+
+static Measurement parse_fast(const char *&ptr) {
+    Measurement result;
+    const char *begin = ptr;
+    uint64_t first = load_word(ptr);
+    uint64_t word = first;
+    uint64_t mask = find_semicolon(word);
+    while (mask == 0) {
+        ptr += 8;
+        word = load_word(ptr);
+        mask = find_semicolon(word);
+    }
+    size_t len = ptr - begin + (std::countr_zero(mask) >> 3);
+    uint64_t last = len >= 8 ? load_word(begin + len - 8) : 0;
+    result.name = {begin, len};
+    result.hash = name_hash(first & low_bytes(len), last, len);
+
+    size_t value_len;
+    result.value = decode_value(load_word(begin + len + 1), value_len);
+    ptr = begin + len + 1 + value_len + 1;
+    return result;
+}
+
+// The same, byte by byte
+static Measurement parse_safe(const char *&ptr) {
+    Measurement result;
+    const char *begin = ptr;
+    while (*ptr != ';')
+        ++ptr;
+    size_t len = ptr - begin;
+    uint64_t first = 0;
+    memcpy(&first, begin, std::min<size_t>(len, 8));
+    uint64_t last = len >= 8 ? load_word(begin + len - 8) : 0;
+    result.name = {begin, len};
+    result.hash = name_hash(first, last, len);
+    ++ptr;
+
+    bool negative = *ptr == '-';
+    ptr += negative;
+    int16_t value = 0;
+    for (; *ptr != '\n'; ++ptr)
+        if (*ptr != '.')
+            value = value * 10 + (*ptr - '0');
+    ++ptr;
+    result.value = negative ? -value : value;
+    return result;
+}
+
+// Multi-cursor processing
+//
+// Split the chunk into "Cursors" line aligned sub-ranges and parse them in
+// lockstep: one line from every cursor per iteration. The lines of different
+// cursors don't depend on each other, so the out-of-order core can overlap
+// their parsing and their table misses, instead of waiting for the end of one
+// line to find the start of the next.
+template <size_t Cursors>
+void process_input(DB &db, std::span<const char> data,
+                   const char *file_end) {
+    std::array<const char *, Cursors> iter;
+    std::array<const char *, Cursors> end;
+    const char *chunk_end = data.data() + data.size();
+    for (size_t k = 0; k < Cursors; ++k) {
+        const char *split = data.data() + data.size() * k / Cursors;
+        // Move to the start of the next line (the chunk ends with a newline)
+        if (k != 0)
+            while (split != chunk_end && *(split - 1) != '\n')
+                ++split;
+        iter[k] = split;
+        if (k != 0)
+            end[k - 1] = split;
+    }
+    end[Cursors - 1] = chunk_end;
+
+    // The fast parser needs room for the longest line and its loads after
+    // the current position
+    const char *fast_end = file_end - std::min<size_t>(file_end - data.data(),
+                                                       128);
+    std::array<const char *, Cursors> fast_stop = end;
+    for (auto &stop : fast_stop)
+        stop = std::min(stop, std::max(fast_end, data.data()));
+
+    // Lockstep until the first cursor runs out
+    auto active = [&] {
+        bool result = true;
+        for (size_t k = 0; k < Cursors; ++k)
+            result &= iter[k] < fast_stop[k];
+        return result;
+    };
+    std::array<Measurement, Cursors> records;
+    while (active()) {
+        for (size_t k = 0; k < Cursors; ++k)
+            records[k] = parse_fast(iter[k]);
+        for (size_t k = 0; k < Cursors; ++k)
+            db.record(records[k]);
+    }
+
+    // The rest of the other cursors, one at a time
+    for (size_t k = 0; k < Cursors; ++k) {
+        while (iter[k] < fast_stop[k])
+            db.record(parse_fast(iter[k]));
+        while (iter[k] != end[k])
+            db.record(parse_safe(iter[k]));
+    }
+}
+
+
+template <size_t Cursors>
+std::unordered_map<std::string, Record> process_parallel(MappedFile &file,
+                                                         size_t chunks) {
+    const char *file_end = file.data().data() + file.data().size();
+
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::vector<DB> dbs(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input<Cursors>(dbs[idx], chunk, file_end);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+
+    // Merge the partial DBs
+    std::unordered_map<std::string, Record> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk.filled_) {
+            auto it = merged.find(db_chunk.keys_[idx]);
+            if (it == merged.end()) {
+                merged.insert_or_assign(db_chunk.keys_[idx],
+                                        db_chunk.values_[idx]);
+            } else {
+                it->second.cnt += db_chunk.values_[idx].cnt;
+                it->second.sum += db_chunk.values_[idx].sum;
+                it->second.max =
+                    std::max(it->second.max, db_chunk.values_[idx].max);
+                it->second.min =
+                    std::min(it->second.min, db_chunk.values_[idx].min);
+            }
+        }
+    }
+    return merged;
+}
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+template <size_t Cursors> void run(MappedFile &mfile, size_t chunks) {
+    auto db = process_parallel<Cursors>(mfile, chunks);
+    format_output(std::cout, db);
+}
+
+int main(int argc, char **argv) {
+    // Usage: 26_multi_cursor [threads] [chunk_mb] [--cursors=1|2|3|4]
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    size_t cursors = 1;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--cursors="))
+            cursors = atol(argv[i] + arg.find('=') + 1);
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    switch (cursors) {
+    case 1:
+        run<1>(mfile, chunks);
+        break;
+    case 2:
+        run<2>(mfile, chunks);
+        break;
+    case 3:
+        run<3>(mfile, chunks);
+        break;
+    case 4:
+        run<4>(mfile, chunks);
+        break;
+    default:
+        std::cerr << "Unsupported number of cursors: " << cursors << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+// Queries
+//
+// A query selects stations and rows and groups the selected stations:
+//
+//   all              every station (the challenge)
+//   prefix=Ham       only stations whose name starts with "Ham"
+//   min=-5.0         only rows with a value of at least -5.0
+//   max=30.0         only rows with a value of at most 30.0
+//   group=2          group the stations by the first 2 bytes of the name
+//
+// The parts are combined with ',', e.g. "prefix=B,min=0.0,group=3".
+struct Query {
+    std::string spec;
+    std::string prefix;
+    int16_t min = INT16_MIN;
+    int16_t max = INT16_MAX;
+    size_t group = SIZE_MAX;
+
+    static std::optional<Query> parse(std::string_view spec) {
+        Query query;
+        query.spec = spec;
+        for (auto part : std::views::split(spec, ',')) {
+            std::string_view item(part.begin(), part.end());
+            std::string_view key = item.substr(0, item.find('='));
+            std::string_view value =
+                item.substr(std::min(item.size(), key.size() + 1));
+            bool valid = true;
+            if (item == "all")
+                continue;
+            else if (key == "prefix")
+                query.prefix = value;
+            else if (key == "min")
+                valid = parse_value(value, query.min);
+            else if (key == "max")
+                valid = parse_value(value, query.max);
+            else if (key == "group")
+                valid = std::from_chars(value.begin(), value.end(),
+                                        query.group)
+                            .ec == std::errc{};
+            else
+                valid = false;
+            if (not valid)
+                return std::nullopt;
+        }
+        return query;
+    }
+
+    // The group of the station, nullopt if the station isn't selected
+    std::optional<std::string_view> group_of(std::string_view name) const {
+        if (not name.starts_with(prefix))
+            return std::nullopt;
+        return name.substr(0, group);
+    }
+
+  private:
+    // Fixed point with one decimal, like the measurements
+    static bool parse_value(std::string_view text, int16_t &out) {
+        double value;
+        if (std::from_chars(text.begin(), text.end(), value).ec != std::errc{})
+            return false;
+        out = std::lround(std::clamp(value * 10, double(INT16_MIN),
+                                     double(INT16_MAX)));
+        return true;
+    }
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+
+    void update(int16_t value) {
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+        ++cnt;
+    }
+};
+
+// The groups of one query, the deque keeps the aggregates in place
+struct Groups {
+    Record *add(std::string_view key) {
+        auto [it, added] = index.try_emplace(std::string(key), nullptr);
+        if (added)
+            it->second = &values.emplace_back(0, 0, INT16_MAX, INT16_MIN);
+        return it->second;
+    }
+
+    std::unordered_map<std::string, Record *> index;
+    std::deque<Record> values;
+};
+
+// The station table from 09_dynamic_chunks.cpp, but a slot doesn't hold the
+// aggregates. Instead it holds the group of the station in every query, which
+// is decided once per station when it is first seen. A row is parsed and
+// looked up once and then only costs one update per query that selects it.
+struct DB {
+    explicit DB(std::span<const Query> queries)
+        : keys_{}, groups_((UINT16_MAX + 1) * queries.size()),
+          tables_(queries.size()) {
+        for (auto &query : queries) {
+            queries_.push_back(&query);
+            ranges_.push_back({query.min, query.max});
+        }
+    }
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a new station
+        if (keys_[slot].empty())
+            add_station(slot, record.name);
+
+        // Update every query that selects this row
+        Record *const *groups = &groups_[slot * ranges_.size()];
+        for (size_t q = 0; q < ranges_.size(); ++q)
+            if (groups[q] != nullptr && record.value >= ranges_[q].min &&
+                record.value <= ranges_[q].max)
+                groups[q]->update(record.value);
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    void add_station(size_t slot, std::string_view name) {
+        keys_[slot] = name;
+        Record **groups = &groups_[slot * queries_.size()];
+        for (size_t q = 0; q < queries_.size(); ++q) {
+            auto group = queries_[q]->group_of(name);
+            groups[q] = group ? tables_[q].add(*group) : nullptr;
+        }
+    }
+
+    struct Range {
+        int16_t min;
+        int16_t max;
+    };
+
+    std::vector<const Query *> queries_;
+    // The value filters of the queries, kept apart from the rest of the query
+    std::vector<Range> ranges_;
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // The group of every slot in every query (nullptr if the station isn't
+    // selected), one entry per query for every slot
+    std::vector<Record *> groups_;
+    // The aggregates of every query
+    std::vector<Groups> tables_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+using Result = std::unordered_map<std::string, Record>;
+
+// One pass over the file for all the queries, one result per query
+std::vector<Result> process_parallel(MappedFile &file, size_t chunks,
+                                     std::span<const Query> queries) {
+    std::vector<DB> dbs;
+    dbs.reserve(chunks);
+    for (size_t i = 0; i < chunks; ++i)
+        dbs.emplace_back(queries);
+
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input(dbs[idx], chunk);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+
+    // Merge the partial DBs, per query
+    std::vector<Result> results(queries.size());
+    for (auto &db_chunk : dbs) {
+        for (size_t q = 0; q < queries.size(); ++q) {
+            auto &groups = db_chunk.tables_[q];
+            for (auto &[key, group] : groups.index) {
+                auto &value = *group;
+                // No row of the group passed the value filter
+                if (value.cnt == 0)
+                    continue;
+                auto it = results[q].find(key);
+                if (it == results[q].end()) {
+                    results[q].insert_or_assign(key, value);
+                } else {
+                    it->second.cnt += value.cnt;
+                    it->second.sum += value.sum;
+                    it->second.max = std::max(it->second.max, value.max);
+                    it->second.min = std::min(it->second.min, value.min);
+                }
+            }
+        }
+    }
+    return results;
+}
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+int main(int argc, char **argv) {
+    // Usage: 27_multi_query [threads] [chunk_mb] [--query=SPEC]...
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    std::vector<Query> queries;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--query=")) {
+            auto query = Query::parse(arg.substr(arg.find('=') + 1));
+            if (not query) {
+                std::cerr << "Invalid query: " << arg << "\n";
+                return 1;
+            }
+            queries.push_back(std::move(*query));
+        } else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    if (queries.empty())
+        queries.push_back(*Query::parse("all"));
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    auto results = process_parallel(mfile, chunks, queries);
+    // A single query prints the plain result, several are labelled
+    for (size_t q = 0; q < queries.size(); ++q) {
+        if (queries.size() > 1)
+            std::cout << queries[q].spec << ": ";
+        format_output(std::cout, results[q]);
+    }
+}
@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <immintrin.h>
+#include <iomanip>
+#include <iostream>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() { return next_chunk(chunk_sz_); }
+
+    std::span<const char> next_chunk(size_t chunk_sz) {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    template <typename Fn> void for_each(Fn &&fn) const {
+        for (auto slot : filled_)
+            fn(keys_[slot], values_[slot]);
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+// Partition, then aggregate
+//
+// DB::record does a read-modify-write of the Record of the station for every
+// row, with branches for the min and max. PartitionedDB only appends the value
+// to a small buffer of the station and reduces the buffer once it is full:
+// the min, max and sum of 32 values are a handful of SSE2 instructions over a
+// single cache line, without any data dependent branches. The stations are
+// numbered in the order they are first seen, so the buffers of all stations
+// stay dense (64 bytes per station).
+struct PartitionedDB {
+    static constexpr size_t batch = 32;
+
+    struct alignas(64) Buffer {
+        std::array<int16_t, batch> values;
+    };
+
+    PartitionedDB() : keys_{}, ids_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a new station
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            ids_[slot] = records_.size();
+            records_.push_back(Record{0, 0, INT16_MAX, INT16_MIN});
+            buffers_.emplace_back();
+            fill_.push_back(0);
+        }
+
+        // Append, and reduce if the buffer is full
+        uint16_t id = ids_[slot];
+        buffers_[id].values[fill_[id]] = record.value;
+        if (++fill_[id] == batch) {
+            reduce(records_[id], buffers_[id]);
+            fill_[id] = 0;
+        }
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    static void reduce(Record &record, const Buffer &buffer) {
+        const __m128i ones = _mm_set1_epi16(1);
+        auto load = [&](size_t i) {
+            return _mm_load_si128(
+                reinterpret_cast<const __m128i *>(buffer.values.data() + i));
+        };
+
+        __m128i min = load(0);
+        __m128i max = min;
+        __m128i sum = _mm_madd_epi16(min, ones); // pairwise into int32
+        for (size_t i = 8; i < batch; i += 8) {
+            __m128i values = load(i);
+            min = _mm_min_epi16(min, values);
+            max = _mm_max_epi16(max, values);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(values, ones));
+        }
+
+        // Horizontal reduction: fold the upper half onto the lower half until
+        // a single lane is left (the sum already is in 4 int32 lanes)
+        auto fold = [](__m128i v, int shuffle) {
+            return shuffle == 0 ? _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))
+                                : _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        };
+        for (int shuffle = 0; shuffle < 2; ++shuffle) {
+            min = _mm_min_epi16(min, fold(min, shuffle));
+            max = _mm_max_epi16(max, fold(max, shuffle));
+            sum = _mm_add_epi32(sum, fold(sum, shuffle));
+        }
+        min = _mm_min_epi16(min, _mm_srli_epi32(min, 16));
+        max = _mm_max_epi16(max, _mm_srli_epi32(max, 16));
+
+        record.cnt += batch;
+        record.sum += _mm_cvtsi128_si32(sum);
+        record.min = std::min<int16_t>(record.min, _mm_extract_epi16(min, 0));
+        record.max = std::max<int16_t>(record.max, _mm_extract_epi16(max, 0));
+    }
+
+    // Fold the partially filled buffers into the records
+    void finish() {
+        for (size_t id = 0; id < records_.size(); ++id) {
+            for (size_t i = 0; i < fill_[id]; ++i) {
+                int16_t value = buffers_[id].values[i];
+                records_[id].min = std::min(records_[id].min, value);
+                records_[id].max = std::max(records_[id].max, value);
+                records_[id].sum += value;
+                ++records_[id].cnt;
+            }
+            fill_[id] = 0;
+        }
+    }
+
+    template <typename Fn> void for_each(Fn &&fn) const {
+        for (auto slot : filled_)
+            fn(keys_[slot], records_[ids_[slot]]);
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Station number of every used slot
+    std::array<uint16_t, UINT16_MAX + 1> ids_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+    // Per station: the aggregates and the values not reduced yet
+    std::vector<Record> records_;
+    std::vector<Buffer> buffers_;
+    std::vector<uint8_t> fill_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+template <typename DB> void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+// Engine selection
+//
+// Which engine is faster depends on the number of stations and their skew
+// (how often a buffer fills up, and whether the records or the buffers stay
+// in the cache) as well as on the machine. With --engine=auto, every worker
+// times both engines on its first few small chunks, alternating so that
+// neither one pays alone for the first touch of its table, and keeps the
+// faster one for the rest of the input. The calibration chunks are regular
+// input, their results are merged like any other.
+enum class Engine { direct, partitioned, automatic };
+
+struct Worker {
+    DB direct;
+    PartitionedDB partitioned;
+    double direct_rate = 0;
+    double partitioned_rate = 0;
+    Engine engine = Engine::direct;
+};
+
+static constexpr size_t calibration_chunk = 1024 * 1024;
+static constexpr size_t calibration_rounds = 2;
+
+// Bytes per second of processing one chunk
+template <typename DB>
+static double process_timed(DB &db, std::span<const char> chunk) {
+    auto start = std::chrono::steady_clock::now();
+    process_input(db, chunk);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return chunk.size() / elapsed.count();
+}
+
+static Engine calibrate(Worker &worker, MappedFile &file) {
+    for (size_t round = 0; round < calibration_rounds; ++round) {
+        auto chunk = file.next_chunk(calibration_chunk);
+        if (chunk.empty())
+            break;
+        worker.direct_rate =
+            std::max(worker.direct_rate, process_timed(worker.direct, chunk));
+        chunk = file.next_chunk(calibration_chunk);
+        if (chunk.empty())
+            break;
+        worker.partitioned_rate = std::max(
+            worker.partitioned_rate, process_timed(worker.partitioned, chunk));
+    }
+    return worker.partitioned_rate > worker.direct_rate ? Engine::partitioned
+                                                        : Engine::direct;
+}
+
+template <typename DB> static void process_chunks(DB &db, MappedFile &file) {
+    auto chunk = file.next_chunk();
+    while (not chunk.empty()) {
+        process_input(db, chunk);
+        chunk = file.next_chunk();
+    }
+}
+
+std::unordered_map<std::string, Record>
+process_parallel(MappedFile &file, size_t chunks, Engine engine, bool verbose) {
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::vector<Worker> workers(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto &worker = workers[idx];
+            worker.engine = engine;
+            if (engine == Engine::automatic)
+                worker.engine = calibrate(worker, file);
+
+            if (worker.engine == Engine::partitioned)
+                process_chunks(worker.partitioned, file);
+            else
+                process_chunks(worker.direct, file);
+            worker.partitioned.finish();
+        });
+    }
+    runners.clear(); // join threads
+
+    if (verbose && engine == Engine::automatic) {
+        for (size_t i = 0; i < workers.size(); ++i)
+            std::cerr << "worker " << i << ": direct "
+                      << workers[i].direct_rate / 1e9 << " GB/s, partitioned "
+                      << workers[i].partitioned_rate / 1e9 << " GB/s -> "
+                      << (workers[i].engine == Engine::partitioned
+                              ? "partitioned"
+                              : "direct")
+                      << "\n";
+    }
+
+    // Merge the partial DBs, a worker can have results in both engines
+    std::unordered_map<std::string, Record> merged;
+    auto merge = [&](const std::string &name, const Record &record) {
+        auto it = merged.find(name);
+        if (it == merged.end()) {
+            merged.insert_or_assign(name, record);
+        } else {
+            it->second.cnt += record.cnt;
+            it->second.sum += record.sum;
+            it->second.max = std::max(it->second.max, record.max);
+            it->second.min = std::min(it->second.min, record.min);
+        }
+    };
+    for (auto &worker : workers) {
+        worker.direct.for_each(merge);
+        worker.partitioned.for_each(merge);
+    }
+    return merged;
+}
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+int main(int argc, char **argv) {
+    // Usage: 28_partitioned [threads] [chunk_mb]
+    //            [--engine=direct|partitioned|auto] [--plan]
+    //
+    // --plan prints the calibration of every worker to stderr.
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    std::string_view engine = "auto";
+    bool verbose = false;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--engine="))
+            engine = arg.substr(arg.find('=') + 1);
+        else if (arg == "--plan")
+            verbose = true;
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    Engine selected;
+    if (engine == "direct")
+        selected = Engine::direct;
+    else if (engine == "partitioned")
+        selected = Engine::partitioned;
+    else if (engine == "auto")
+        selected = Engine::automatic;
+    else {
+        std::cerr << "Unknown engine: " << engine << "\n";
+        return 1;
+    }
+
+    auto db = process_parallel(mfile, chunks, selected, verbose);
+    format_output(std::cout, db);
+}
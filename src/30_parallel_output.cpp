@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+
+struct Measurement {
+    std::string_view name;
+    uint32_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+// The table from 09_dynamic_chunks.cpp, but with a 32 bit hash and growing
+// once it is half full: the feeds this variant is meant for have hundreds of
+// thousands of stations, more than the 65536 slots of the fixed table.
+struct DB {
+    DB() { resize(UINT16_MAX + 1); }
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record.name, record.hash);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            if (2 * (filled_.size() + 1) > keys_.size()) {
+                resize(2 * keys_.size());
+                slot = lookup_slot(record.name, record.hash);
+            }
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            hashes_[slot] = record.hash;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(std::string_view name, uint32_t hash) const {
+        // Fibonacci hashing, the top bits of the product are the best mixed
+        size_t slot = (hash * 0x9E3779B97F4A7C15) >> shift_;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == name)
+                break;
+            // Otherwise we have a collision
+            slot = (slot + 1) & (keys_.size() - 1);
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    void resize(size_t slots) {
+        auto keys = std::exchange(keys_, std::vector<std::string>(slots));
+        auto values = std::exchange(values_, std::vector<Record>(slots));
+        auto hashes = std::exchange(hashes_, std::vector<uint32_t>(slots));
+        shift_ = 64 - std::countr_zero(slots);
+        for (auto &idx : filled_) {
+            size_t slot = lookup_slot(keys[idx], hashes[idx]);
+            keys_[slot] = std::move(keys[idx]);
+            values_[slot] = values[idx];
+            hashes_[slot] = hashes[idx];
+            idx = slot;
+        }
+    }
+
+    // Keys
+    std::vector<std::string> keys_;
+    // Values
+    std::vector<Record> values_;
+    // Hashes, to move the keys when the table grows
+    std::vector<uint32_t> hashes_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+    int shift_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+std::unordered_map<std::string, Record> process_parallel(MappedFile &file,
+                                                         size_t chunks) {
+    // Process the chunks in separate thread each
+    std::vector<std::jthread> runners(chunks);
+    std::vector<DB> dbs(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                process_input(dbs[idx], chunk);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+
+    // Merge the partial DBs
+    std::unordered_map<std::string, Record> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk.filled_) {
+            auto it = merged.find(db_chunk.keys_[idx]);
+            if (it == merged.end()) {
+                merged.insert_or_assign(db_chunk.keys_[idx],
+                                        db_chunk.values_[idx]);
+            } else {
+                it->second.cnt += db_chunk.values_[idx].cnt;
+                it->second.sum += db_chunk.values_[idx].sum;
+                it->second.max =
+                    std::max(it->second.max, db_chunk.values_[idx].max);
+                it->second.min =
+                    std::min(it->second.min, db_chunk.values_[idx].min);
+            }
+        }
+    }
+    return merged;
+}
+
+// The output of 09_dynamic_chunks.cpp, for comparison
+void format_output_serial(std::ostream &out,
+                          std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+// Parallel output
+//
+// With hundreds of thousands of stations, the format_output of
+// 09_dynamic_chunks.cpp (copy all names, a single threaded sort, a hash
+// lookup per name and an ostream per value) takes seconds after the parsing
+// is done. Here the entries are sorted by an 8 byte prefix of the name,
+// formatted into one buffer per thread and written out with a single writev.
+// The bytes are exactly the ones format_output produces.
+
+struct Entry {
+    // The first 8 bytes of the name in big endian (zero padded), comparing
+    // the prefixes as integers orders them like the names
+    uint64_t prefix;
+    const std::string *name;
+    const Record *value;
+};
+
+static uint64_t name_prefix(const std::string &name) {
+    uint64_t prefix = 0;
+    memcpy(&prefix, name.data(), std::min<size_t>(name.size(), 8));
+    return std::byteswap(prefix);
+}
+
+// Runs fn(thread, begin, end) on "threads" threads for an even split of
+// [0, size)
+template <typename Fn>
+static void parallel_for(size_t threads, size_t size, Fn &&fn) {
+    std::vector<std::jthread> runners(threads);
+    for (size_t t = 0; t < threads; ++t)
+        runners[t] = std::jthread(
+            [&, t] { fn(t, size * t / threads, size * (t + 1) / threads); });
+}
+
+// MSD radix sort on the top 16 bits of the prefix, then a comparison sort
+// within each bucket (names with the same 8 byte prefix fall back to the
+// full name)
+static std::vector<Entry> sort_entries(std::vector<Entry> entries,
+                                       size_t threads) {
+    constexpr size_t buckets = 1 << 16;
+    auto bucket_of = [](const Entry &entry) { return entry.prefix >> 48; };
+
+    // Histogram of every thread's range, then the offset of every thread
+    // within every bucket
+    std::vector<std::vector<size_t>> counts(
+        threads, std::vector<size_t>(buckets, 0));
+    parallel_for(threads, entries.size(), [&](size_t t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+            ++counts[t][bucket_of(entries[i])];
+    });
+    std::vector<size_t> bucket_begin(buckets + 1, 0);
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < buckets; ++bucket) {
+        bucket_begin[bucket] = offset;
+        for (size_t t = 0; t < threads; ++t)
+            offset += std::exchange(counts[t][bucket], offset);
+    }
+    bucket_begin[buckets] = offset;
+
+    // Scatter, every thread into its own part of every bucket
+    std::vector<Entry> sorted(entries.size());
+    parallel_for(threads, entries.size(), [&](size_t t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+            sorted[counts[t][bucket_of(entries[i])]++] = entries[i];
+    });
+
+    // Sort the buckets, each thread takes a contiguous run of buckets with
+    // about the same number of entries
+    std::vector<size_t> split(threads + 1, buckets);
+    split[0] = 0;
+    for (size_t t = 1, bucket = 0; t < threads; ++t) {
+        while (bucket < buckets &&
+               bucket_begin[bucket] < sorted.size() * t / threads)
+            ++bucket;
+        split[t] = bucket;
+    }
+    parallel_for(threads, threads, [&](size_t t, size_t, size_t) {
+        for (size_t bucket = split[t]; bucket < split[t + 1]; ++bucket)
+            std::sort(sorted.begin() + bucket_begin[bucket],
+                      sorted.begin() + bucket_begin[bucket + 1],
+                      [](const Entry &lhs, const Entry &rhs) {
+                          if (lhs.prefix != rhs.prefix)
+                              return lhs.prefix < rhs.prefix;
+                          return *lhs.name < *rhs.name;
+                      });
+    });
+    return sorted;
+}
+
+// "value / 10.0" with std::fixed and std::setprecision(1)
+static void append_tenths(std::string &out, double value) {
+    char buffer[32];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value,
+                                   std::chars_format::fixed, 1);
+    out.append(buffer, end);
+}
+
+static void format_entry(std::string &out, const Entry &entry) {
+    const Record &value = *entry.value;
+    int64_t sum = value.sum;
+    // Correct rounding
+    if (sum > 0)
+        sum += value.cnt / 2;
+    else
+        sum -= value.cnt / 2;
+    out += *entry.name;
+    out += '=';
+    append_tenths(out, value.min / 10.0);
+    out += '/';
+    append_tenths(out, (sum / value.cnt) / 10.0);
+    out += '/';
+    append_tenths(out, value.max / 10.0);
+}
+
+static void write_all(int fd, std::span<const std::string> buffers) {
+    std::vector<iovec> iov;
+    for (auto &buffer : buffers)
+        if (not buffer.empty())
+            iov.push_back({const_cast<char *>(buffer.data()), buffer.size()});
+
+    // writev can stop early (and takes at most IOV_MAX buffers)
+    size_t first = 0;
+    while (first < iov.size()) {
+        int cnt = std::min<size_t>(iov.size() - first, IOV_MAX);
+        ssize_t written = writev(fd, iov.data() + first, cnt);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to write the output");
+        }
+        while (first < iov.size() && size_t(written) >= iov[first].iov_len)
+            written -= iov[first++].iov_len;
+        if (first < iov.size()) {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) +
+                                  written;
+            iov[first].iov_len -= written;
+        }
+    }
+}
+
+void format_output(int fd, const std::unordered_map<std::string, Record> &db,
+                   size_t threads) {
+    std::vector<Entry> entries;
+    entries.reserve(db.size());
+    for (auto &[name, value] : db)
+        entries.push_back({0, &name, &value});
+    parallel_for(threads, entries.size(), [&](size_t, size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i)
+            entries[i].prefix = name_prefix(*entries[i].name);
+    });
+    entries = sort_entries(std::move(entries), threads);
+
+    // Each thread formats a contiguous range, the separator goes in front of
+    // every entry but the first
+    std::vector<std::string> buffers{"{"};
+    buffers.resize(threads + 1);
+    buffers.emplace_back("}\n");
+    parallel_for(threads, entries.size(), [&](size_t t, size_t b, size_t e) {
+        auto &out = buffers[t + 1];
+        out.reserve((e - b) * 40);
+        for (size_t i = b; i < e; ++i) {
+            if (i != 0)
+                out += ", ";
+            format_entry(out, entries[i]);
+        }
+    });
+    write_all(fd, buffers);
+}
+
+int main(int argc, char **argv) try {
+    // Usage: 30_parallel_output [threads] [chunk_mb] [--output=parallel|serial]
+    //            [--timing]
+    //
+    // The output stage uses the same number of threads as the processing,
+    // --timing prints the time spent in both to stderr.
+    size_t chunks = 1;
+    size_t chunk_mb = 64;
+    bool serial = false;
+    bool timing = false;
+    for (int i = 1, pos = 0; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--output=serial")
+            serial = true;
+        else if (arg == "--output=parallel")
+            serial = false;
+        else if (arg == "--timing")
+            timing = true;
+        else if (pos++ == 0)
+            chunks = atol(argv[i]);
+        else
+            chunk_mb = atol(argv[i]);
+    }
+    MappedFile mfile("measurements.txt", chunk_mb * 1024 * 1024);
+
+    auto start = std::chrono::steady_clock::now();
+    auto db = process_parallel(mfile, chunks);
+    auto processed = std::chrono::steady_clock::now();
+    if (serial) {
+        format_output_serial(std::cout, db);
+        if (not std::cout.flush())
+            throw std::runtime_error("Failed to write the output");
+    } else {
+        format_output(STDOUT_FILENO, db, chunks);
+    }
+    auto done = std::chrono::steady_clock::now();
+
+    if (timing) {
+        std::chrono::duration<double> processing = processed - start;
+        std::chrono::duration<double> output = done - processed;
+        std::cerr << db.size() << " stations, processing: "
+                  << processing.count() << " s, output: " << output.count()
+                  << " s\n";
+    }
+} catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+// Aggregate policies
+//
+// A policy describes the per-station state and the four operations the engine
+// needs: init (first row of a station), update (every other row), merge
+// (combining per-thread tables) and format (the text after "name=").
+// Everything is static, so the table below inlines the policy into the hot
+// loop and only pays for the statistics it actually keeps.
+
+// The statistics required by the challenge: min/mean/max
+struct MinMeanMax {
+    struct State {
+        int64_t cnt;
+        int64_t sum;
+
+        int16_t min;
+        int16_t max;
+    };
+
+    static State init(const Measurement &m) {
+        return State{1, m.value, m.value, m.value};
+    }
+
+    static void update(State &s, const Measurement &m) {
+        if (m.value < s.min)
+            s.min = m.value;
+        else if (m.value > s.max)
+            s.max = m.value;
+        s.sum += m.value;
+        ++s.cnt;
+    }
+
+    static void merge(State &into, const State &from) {
+        into.cnt += from.cnt;
+        into.sum += from.sum;
+        into.max = std::max(into.max, from.max);
+        into.min = std::min(into.min, from.min);
+    }
+
+    // Expects the stream to be in fixed mode with precision 1
+    static void format(std::ostream &out, const State &s) {
+        int64_t sum = s.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += s.cnt / 2;
+        else
+            sum -= s.cnt / 2;
+        out << s.min / 10.0 << "/" << (sum / s.cnt) / 10.0 << "/"
+            << s.max / 10.0;
+    }
+};
+
+// min/mean/max/stddev using an exact integer sum of squares
+//
+// The values are tenths in [-999, 999], so the sum of squares of one billion
+// rows stays below 10^15 and fits into int64_t without any rounding.
+struct Variance {
+    struct State {
+        MinMeanMax::State base;
+        int64_t sum_sq;
+    };
+
+    static State init(const Measurement &m) {
+        return State{MinMeanMax::init(m), int64_t{m.value} * m.value};
+    }
+
+    static void update(State &s, const Measurement &m) {
+        MinMeanMax::update(s.base, m);
+        s.sum_sq += int64_t{m.value} * m.value;
+    }
+
+    static void merge(State &into, const State &from) {
+        MinMeanMax::merge(into.base, from.base);
+        into.sum_sq += from.sum_sq;
+    }
+
+    static void format(std::ostream &out, const State &s) {
+        MinMeanMax::format(out, s.base);
+        double mean = static_cast<double>(s.base.sum) / s.base.cnt;
+        double var = static_cast<double>(s.sum_sq) / s.base.cnt - mean * mean;
+        out << "/" << std::sqrt(std::max(var, 0.0)) / 10.0;
+    }
+};
+
+// min/mean/max/stddev using Welford's online algorithm
+//
+// Numerically stable for any input, but a floating point division on every
+// row makes it noticeably slower than Variance.
+struct Welford {
+    struct State {
+        int64_t cnt;
+        double mean;
+        double m2;
+
+        int16_t min;
+        int16_t max;
+    };
+
+    static State init(const Measurement &m) {
+        return State{1, double(m.value), 0.0, m.value, m.value};
+    }
+
+    static void update(State &s, const Measurement &m) {
+        if (m.value < s.min)
+            s.min = m.value;
+        else if (m.value > s.max)
+            s.max = m.value;
+        ++s.cnt;
+        double delta = m.value - s.mean;
+        s.mean += delta / s.cnt;
+        s.m2 += delta * (m.value - s.mean);
+    }
+
+    // Chan et al. parallel combination
+    static void merge(State &into, const State &from) {
+        int64_t cnt = into.cnt + from.cnt;
+        double delta = from.mean - into.mean;
+        into.m2 += from.m2 + delta * delta * into.cnt * from.cnt / cnt;
+        into.mean += delta * from.cnt / cnt;
+        into.cnt = cnt;
+        into.max = std::max(into.max, from.max);
+        into.min = std::min(into.min, from.min);
+    }
+
+    static void format(std::ostream &out, const State &s) {
+        out << s.min / 10.0 << "/" << std::round(s.mean) / 10.0 << "/"
+            << s.max / 10.0 << "/" << std::sqrt(s.m2 / s.cnt) / 10.0;
+    }
+};
+
+// Fixed-width histogram over the valid range [-99.9, 99.9]
+template <size_t Buckets> struct Histogram {
+    static_assert(Buckets > 0 && Buckets <= 1999);
+    static constexpr int width = (1999 + Buckets - 1) / Buckets;
+
+    struct State {
+        std::array<uint32_t, Buckets> counts;
+    };
+
+    static size_t bucket(int16_t value) {
+        return std::min<size_t>((value + 999) / width, Buckets - 1);
+    }
+
+    static State init(const Measurement &m) {
+        State s{};
+        ++s.counts[bucket(m.value)];
+        return s;
+    }
+
+    static void update(State &s, const Measurement &m) {
+        ++s.counts[bucket(m.value)];
+    }
+
+    static void merge(State &into, const State &from) {
+        for (size_t i = 0; i < Buckets; ++i)
+            into.counts[i] += from.counts[i];
+    }
+
+    static void format(std::ostream &out, const State &s) {
+        std::string_view delim = "";
+        out << "[";
+        for (auto cnt : s.counts)
+            out << std::exchange(delim, ",") << cnt;
+        out << "]";
+    }
+};
+
+// The most recent value (in file order) for each station
+//
+// The station name points into the memory mapped input, so its address
+// doubles as the position of the row in the file.
+struct LastValue {
+    struct State {
+        const char *pos;
+        int16_t value;
+    };
+
+    static State init(const Measurement &m) {
+        return State{m.name.data(), m.value};
+    }
+
+    static void update(State &s, const Measurement &m) {
+        s.pos = m.name.data();
+        s.value = m.value;
+    }
+
+    static void merge(State &into, const State &from) {
+        if (from.pos > into.pos)
+            into = from;
+    }
+
+    static void format(std::ostream &out, const State &s) {
+        out << s.value / 10.0;
+    }
+};
+
+template <typename Aggregate = MinMeanMax> struct DB {
+    using State = typename Aggregate::State;
+
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Aggregate::init(record);
+            return;
+        }
+
+        // Otherwise we have a hit
+        Aggregate::update(values_[slot], record);
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<State, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
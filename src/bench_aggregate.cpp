@@ -0,0 +1,88 @@
+#include "aggregate.h"
+#include "bench_fixture.h"
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <span>
+#include <vector>
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    bool negative = (*iter == '-');
+    int16_t value = 0;
+    while (*iter != '\n') {
+        if (*iter >= '0' && *iter <= '9')
+            value = value * 10 + (*iter - '0');
+        ++iter;
+    }
+    ++iter;
+    result.value = negative ? -value : value;
+
+    return result;
+}
+
+// Parse the input upfront, so that only the table update is measured
+static std::vector<Measurement> load_measurements(std::vector<char> &data,
+                                                  size_t stations) {
+    data = load_fixture(stations);
+    std::span<const char> input(data);
+
+    std::vector<Measurement> result;
+    auto iter = input.begin();
+    while (iter != input.end())
+        result.push_back(parse(iter));
+    return result;
+}
+
+template <typename Aggregate> static void BM_record(benchmark::State &state) {
+    std::vector<char> data;
+    auto measurements = load_measurements(data, state.range(0));
+    // The tables are too large for the stack
+    auto db = std::make_unique<DB<Aggregate>>();
+
+    for (auto _ : state) {
+        for (auto &m : measurements)
+            db->record(m);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * measurements.size());
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK_TEMPLATE(BM_record, MinMeanMax)->Arg(413)->Arg(10'000);
+BENCHMARK_TEMPLATE(BM_record, Variance)->Arg(413)->Arg(10'000);
+BENCHMARK_TEMPLATE(BM_record, Welford)->Arg(413)->Arg(10'000);
+BENCHMARK_TEMPLATE(BM_record, Histogram<20>)->Arg(413)->Arg(10'000);
+BENCHMARK_TEMPLATE(BM_record, LastValue)->Arg(413)->Arg(10'000);
+
+template <typename Aggregate> static void BM_merge(benchmark::State &state) {
+    std::vector<char> data;
+    auto measurements = load_measurements(data, state.range(0));
+    auto db = std::make_unique<DB<Aggregate>>();
+    for (auto &m : measurements)
+        db->record(m);
+
+    typename Aggregate::State into = db->values_[db->filled_.front()];
+    for (auto _ : state) {
+        for (auto idx : db->filled_)
+            Aggregate::merge(into, db->values_[idx]);
+        benchmark::DoNotOptimize(into);
+    }
+    state.SetItemsProcessed(state.iterations() * db->filled_.size());
+}
+BENCHMARK_TEMPLATE(BM_merge, MinMeanMax)->Arg(413)->Arg(10'000);
+BENCHMARK_TEMPLATE(BM_merge, Variance)->Arg(413)->Arg(10'000);
+BENCHMARK_TEMPLATE(BM_merge, Welford)->Arg(413)->Arg(10'000);
+BENCHMARK_TEMPLATE(BM_merge, Histogram<20>)->Arg(413)->Arg(10'000);
+BENCHMARK_TEMPLATE(BM_merge, LastValue)->Arg(413)->Arg(10'000);
+
+BENCHMARK_MAIN();
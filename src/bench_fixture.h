@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Benchmark inputs produced by the "fixtures" target (see CMakeLists.txt).
+// Each fixture has one million rows, large enough to not fit into the caches.
+// The directory can be overridden with the BENCH_FIXTURES environment variable.
+inline std::filesystem::path fixture_path(const std::string &name) {
+    const char *dir = std::getenv("BENCH_FIXTURES");
+    return std::filesystem::path(dir != nullptr ? dir : "fixtures") /
+           (name + ".txt");
+}
+
+inline std::filesystem::path fixture_path(size_t stations) {
+    return fixture_path("stations_" + std::to_string(stations));
+}
+
+inline std::vector<char> load_fixture(const std::filesystem::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (not in)
+        throw std::runtime_error("Missing fixture " + path.string() +
+                                 ", build the \"fixtures\" target");
+    return {std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>()};
+}
+
+inline std::vector<char> load_fixture(size_t stations) {
+    return load_fixture(fixture_path(stations));
+}
@@ -0,0 +1,100 @@
+#include "bench_fixture.h"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <iomanip>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The output formatting from 09_dynamic_chunks.cpp
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+void format_output(std::ostream &out,
+                   std::unordered_map<std::string, Record> &db) {
+    std::vector<std::string> names(db.size());
+    // Grab all the unique station names
+    std::ranges::copy(db | std::views::keys, names.begin());
+    // Sorting UTF-8 strings lexicographically is the same
+    // as sorting by codepoint value
+    std::ranges::sort(names, std::less<>{});
+
+    std::string delim = "";
+
+    out << std::setiosflags(out.fixed | out.showpoint) << std::setprecision(1);
+    out << "{";
+    for (auto &name : names) {
+        auto &value = db[name];
+
+        int64_t sum = value.sum;
+        // Correct rounding
+        if (sum > 0)
+            sum += value.cnt / 2;
+        else
+            sum -= value.cnt / 2;
+        out << std::exchange(delim, ", ") << name << "=" << value.min / 10.0
+            << "/" << (sum / value.cnt) / 10.0 << "/" << value.max / 10.0;
+    }
+    out << "}\n";
+}
+
+// Aggregate the fixture with a plain parser, the speed doesn't matter here
+static std::unordered_map<std::string, Record> aggregate(size_t stations) {
+    auto data = load_fixture(stations);
+    std::unordered_map<std::string, Record> db;
+    std::string_view input(data.data(), data.size());
+    while (not input.empty()) {
+        auto semicolon = input.find(';');
+        auto newline = input.find('\n', semicolon);
+        std::string name(input.substr(0, semicolon));
+        int16_t value = 0;
+        for (char c : input.substr(semicolon + 1, newline - semicolon - 1))
+            if (c >= '0' && c <= '9')
+                value = value * 10 + (c - '0');
+        if (input[semicolon + 1] == '-')
+            value = -value;
+        input.remove_prefix(newline + 1);
+
+        auto [it, inserted] = db.try_emplace(name, 1, value, value, value);
+        if (not inserted) {
+            it->second.min = std::min(it->second.min, value);
+            it->second.max = std::max(it->second.max, value);
+            it->second.sum += value;
+            ++it->second.cnt;
+        }
+    }
+    return db;
+}
+
+// Args: stations
+static void BM_format_output(benchmark::State &state) {
+    auto db = aggregate(state.range(0));
+
+    std::ostringstream out;
+    for (auto _ : state) {
+        out.str({});
+        format_output(out, db);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations() * db.size());
+    state.SetBytesProcessed(state.iterations() * out.view().size());
+}
+BENCHMARK(BM_format_output)
+    ->Arg(413)
+    ->Arg(10'000)
+    ->Arg(40'000)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,254 @@
+#include "bench_fixture.h"
+
+#include <algorithm>
+#include <array>
+#include <benchmark/benchmark.h>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The table from 09_dynamic_chunks.cpp, with the parsers and the multi-cursor
+// process_input from 26_multi_cursor.cpp
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+// Branch-light line parsing
+//
+// The byte loops of parse() end with a mispredicted branch on every line,
+// which also flushes the work of any other line in flight. For the cursors to
+// overlap, the line parser finds the ';' eight bytes at a time, hashes the
+// first and last word of the name and decodes the value without branches.
+// These loads can reach up to 8 bytes past the line, so the last lines of the
+// file are parsed byte by byte (with the same hash).
+
+static uint64_t load_word(const char *ptr) {
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    return word;
+}
+
+// Mask for the first "bytes" bytes of a little endian word
+static uint64_t low_bytes(size_t bytes) {
+    return bytes >= 8 ? ~uint64_t{0} : (uint64_t{1} << (bytes * 8)) - 1;
+}
+
+// High bit set in the bytes of "word" equal to ';' (exact up to the first)
+static uint64_t find_semicolon(uint64_t word) {
+    uint64_t x = word ^ 0x3B3B3B3B3B3B3B3B;
+    return (x - 0x0101010101010101) & ~x & 0x8080808080808080;
+}
+
+static uint16_t name_hash(uint64_t first, uint64_t last, size_t len) {
+    return ((first ^ std::rotl(last, 29) ^ len) * 0x9E3779B97F4A7C15) >> 48;
+}
+
+// Decode "-?d?d.d" from a single 8 byte load (merykitty's SWAR decoding),
+// "len" is the length of the value
+static int16_t decode_value(uint64_t word, size_t &len) {
+    int dot_bit = std::countr_zero(~word & 0x10101000);
+    int shift = 28 - dot_bit;
+    int64_t sign = (int64_t(~word) << 59) >> 63;
+    uint64_t design_mask = ~(sign & 0xFF);
+    uint64_t digits = ((word & design_mask) << shift) & 0x0F000F0F00;
+    uint64_t abs_value = ((digits * 0x640a0001) >> 32) & 0x3FF;
+    len = (dot_bit >> 3) + 2;
+    return int16_t((abs_value ^ sign) - sign);
+}
+
+static Measurement parse_fast(const char *&ptr) {
+    Measurement result;
+    const char *begin = ptr;
+    uint64_t first = load_word(ptr);
+    uint64_t word = first;
+    uint64_t mask = find_semicolon(word);
+    while (mask == 0) {
+        ptr += 8;
+        word = load_word(ptr);
+        mask = find_semicolon(word);
+    }
+    size_t len = ptr - begin + (std::countr_zero(mask) >> 3);
+    uint64_t last = len >= 8 ? load_word(begin + len - 8) : 0;
+    result.name = {begin, len};
+    result.hash = name_hash(first & low_bytes(len), last, len);
+
+    size_t value_len;
+    result.value = decode_value(load_word(begin + len + 1), value_len);
+    ptr = begin + len + 1 + value_len + 1;
+    return result;
+}
+
+// The same, byte by byte
+static Measurement parse_safe(const char *&ptr) {
+    Measurement result;
+    const char *begin = ptr;
+    while (*ptr != ';')
+        ++ptr;
+    size_t len = ptr - begin;
+    uint64_t first = 0;
+    memcpy(&first, begin, std::min<size_t>(len, 8));
+    uint64_t last = len >= 8 ? load_word(begin + len - 8) : 0;
+    result.name = {begin, len};
+    result.hash = name_hash(first, last, len);
+    ++ptr;
+
+    bool negative = *ptr == '-';
+    ptr += negative;
+    int16_t value = 0;
+    for (; *ptr != '\n'; ++ptr)
+        if (*ptr != '.')
+            value = value * 10 + (*ptr - '0');
+    ++ptr;
+    result.value = negative ? -value : value;
+    return result;
+}
+
+// Multi-cursor processing
+//
+// Split the chunk into "Cursors" line aligned sub-ranges and parse them in
+// lockstep: one line from every cursor per iteration. The lines of different
+// cursors don't depend on each other, so the out-of-order core can overlap
+// their parsing and their table misses, instead of waiting for the end of one
+// line to find the start of the next.
+template <size_t Cursors>
+void process_input(DB &db, std::span<const char> data,
+                   const char *file_end) {
+    std::array<const char *, Cursors> iter;
+    std::array<const char *, Cursors> end;
+    const char *chunk_end = data.data() + data.size();
+    for (size_t k = 0; k < Cursors; ++k) {
+        const char *split = data.data() + data.size() * k / Cursors;
+        // Move to the start of the next line (the chunk ends with a newline)
+        if (k != 0)
+            while (split != chunk_end && *(split - 1) != '\n')
+                ++split;
+        iter[k] = split;
+        if (k != 0)
+            end[k - 1] = split;
+    }
+    end[Cursors - 1] = chunk_end;
+
+    // The fast parser needs room for the longest line and its loads after
+    // the current position
+    const char *fast_end = file_end - std::min<size_t>(file_end - data.data(),
+                                                       128);
+    std::array<const char *, Cursors> fast_stop = end;
+    for (auto &stop : fast_stop)
+        stop = std::min(stop, std::max(fast_end, data.data()));
+
+    // Lockstep until the first cursor runs out
+    auto active = [&] {
+        bool result = true;
+        for (size_t k = 0; k < Cursors; ++k)
+            result &= iter[k] < fast_stop[k];
+        return result;
+    };
+    std::array<Measurement, Cursors> records;
+    while (active()) {
+        for (size_t k = 0; k < Cursors; ++k)
+            records[k] = parse_fast(iter[k]);
+        for (size_t k = 0; k < Cursors; ++k)
+            db.record(records[k]);
+    }
+
+    // The rest of the other cursors, one at a time
+    for (size_t k = 0; k < Cursors; ++k) {
+        while (iter[k] < fast_stop[k])
+            db.record(parse_fast(iter[k]));
+        while (iter[k] != end[k])
+            db.record(parse_safe(iter[k]));
+    }
+}
+
+// Args: 0 for short names (3-8 bytes), 1 for long names (48-100 bytes).
+// Short lines leave little work per line to overlap, long lines spend most of
+// their time in the ';' search. Cursors 1 is the single cursor baseline.
+template <size_t Cursors>
+static void BM_process_input(benchmark::State &state) {
+    bool long_names = state.range(0) != 0;
+    auto data = load_fixture(fixture_path(long_names ? "names_long"
+                                                     : "names_short"));
+    auto db = std::make_unique<DB>();
+    state.SetLabel(long_names ? "long names" : "short names");
+
+    for (auto _ : state) {
+        process_input<Cursors>(*db, data, data.data() + data.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+static void name_lengths(benchmark::internal::Benchmark *bench) {
+    bench->Arg(0);
+    bench->Arg(1);
+}
+
+BENCHMARK_TEMPLATE(BM_process_input, 1)->Apply(name_lengths);
+BENCHMARK_TEMPLATE(BM_process_input, 2)->Apply(name_lengths);
+BENCHMARK_TEMPLATE(BM_process_input, 3)->Apply(name_lengths);
+BENCHMARK_TEMPLATE(BM_process_input, 4)->Apply(name_lengths);
+
+BENCHMARK_MAIN();
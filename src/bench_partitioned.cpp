@@ -0,0 +1,293 @@
+#include "bench_fixture.h"
+
+#include <algorithm>
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <immintrin.h>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The direct and the partitioned engine from 28_partitioned.cpp
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    template <typename Fn> void for_each(Fn &&fn) const {
+        for (auto slot : filled_)
+            fn(keys_[slot], values_[slot]);
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+// Partition, then aggregate
+//
+// DB::record does a read-modify-write of the Record of the station for every
+// row, with branches for the min and max. PartitionedDB only appends the value
+// to a small buffer of the station and reduces the buffer once it is full:
+// the min, max and sum of 32 values are a handful of SSE2 instructions over a
+// single cache line, without any data dependent branches. The stations are
+// numbered in the order they are first seen, so the buffers of all stations
+// stay dense (64 bytes per station).
+struct PartitionedDB {
+    static constexpr size_t batch = 32;
+
+    struct alignas(64) Buffer {
+        std::array<int16_t, batch> values;
+    };
+
+    PartitionedDB() : keys_{}, ids_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a new station
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            ids_[slot] = records_.size();
+            records_.push_back(Record{0, 0, INT16_MAX, INT16_MIN});
+            buffers_.emplace_back();
+            fill_.push_back(0);
+        }
+
+        // Append, and reduce if the buffer is full
+        uint16_t id = ids_[slot];
+        buffers_[id].values[fill_[id]] = record.value;
+        if (++fill_[id] == batch) {
+            reduce(records_[id], buffers_[id]);
+            fill_[id] = 0;
+        }
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    static void reduce(Record &record, const Buffer &buffer) {
+        const __m128i ones = _mm_set1_epi16(1);
+        auto load = [&](size_t i) {
+            return _mm_load_si128(
+                reinterpret_cast<const __m128i *>(buffer.values.data() + i));
+        };
+
+        __m128i min = load(0);
+        __m128i max = min;
+        __m128i sum = _mm_madd_epi16(min, ones); // pairwise into int32
+        for (size_t i = 8; i < batch; i += 8) {
+            __m128i values = load(i);
+            min = _mm_min_epi16(min, values);
+            max = _mm_max_epi16(max, values);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(values, ones));
+        }
+
+        // Horizontal reduction: fold the upper half onto the lower half until
+        // a single lane is left (the sum already is in 4 int32 lanes)
+        auto fold = [](__m128i v, int shuffle) {
+            return shuffle == 0 ? _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))
+                                : _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+        };
+        for (int shuffle = 0; shuffle < 2; ++shuffle) {
+            min = _mm_min_epi16(min, fold(min, shuffle));
+            max = _mm_max_epi16(max, fold(max, shuffle));
+            sum = _mm_add_epi32(sum, fold(sum, shuffle));
+        }
+        min = _mm_min_epi16(min, _mm_srli_epi32(min, 16));
+        max = _mm_max_epi16(max, _mm_srli_epi32(max, 16));
+
+        record.cnt += batch;
+        record.sum += _mm_cvtsi128_si32(sum);
+        record.min = std::min<int16_t>(record.min, _mm_extract_epi16(min, 0));
+        record.max = std::max<int16_t>(record.max, _mm_extract_epi16(max, 0));
+    }
+
+    // Fold the partially filled buffers into the records
+    void finish() {
+        for (size_t id = 0; id < records_.size(); ++id) {
+            for (size_t i = 0; i < fill_[id]; ++i) {
+                int16_t value = buffers_[id].values[i];
+                records_[id].min = std::min(records_[id].min, value);
+                records_[id].max = std::max(records_[id].max, value);
+                records_[id].sum += value;
+                ++records_[id].cnt;
+            }
+            fill_[id] = 0;
+        }
+    }
+
+    template <typename Fn> void for_each(Fn &&fn) const {
+        for (auto slot : filled_)
+            fn(keys_[slot], records_[ids_[slot]]);
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Station number of every used slot
+    std::array<uint16_t, UINT16_MAX + 1> ids_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+    // Per station: the aggregates and the values not reduced yet
+    std::vector<Record> records_;
+    std::vector<Buffer> buffers_;
+    std::vector<uint8_t> fill_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+template <typename DB> void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+// Args: stations, skewed. The skewed fixtures draw the stations from a Zipf
+// distribution (exponent 1.1), most rows hit a few hot stations. Each engine
+// keeps its table between the iterations, like a worker between chunks.
+template <typename DB> static void BM_process_input(benchmark::State &state) {
+    size_t stations = state.range(0);
+    bool skewed = state.range(1) != 0;
+    auto data = load_fixture(
+        skewed ? fixture_path("skewed_" + std::to_string(stations))
+               : fixture_path(stations));
+    auto db = std::make_unique<DB>();
+    state.SetLabel(skewed ? "skewed" : "uniform");
+
+    for (auto _ : state) {
+        process_input(*db, data);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+static void cardinalities(benchmark::internal::Benchmark *bench) {
+    for (int64_t skewed : {0, 1})
+        for (int64_t stations : {413, 2'000, 10'000, 40'000})
+            bench->Args({stations, skewed});
+}
+
+BENCHMARK_TEMPLATE(BM_process_input, DB)->Apply(cardinalities);
+BENCHMARK_TEMPLATE(BM_process_input, PartitionedDB)->Apply(cardinalities);
+
+BENCHMARK_MAIN();
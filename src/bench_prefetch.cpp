@@ -0,0 +1,168 @@
+#include "bench_fixture.h"
+
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The table and parser from 09_dynamic_chunks.cpp, with the batched
+// process_input from 14_prefetch.cpp
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+template <size_t Depth> void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+    std::array<Measurement, Depth> batch;
+
+    while (iter != data.end()) {
+        size_t cnt = 0;
+        while (cnt < Depth && iter != data.end())
+            batch[cnt++] = parse(iter);
+
+        if constexpr (Depth > 1) {
+            for (size_t i = 0; i < cnt; ++i) {
+                __builtin_prefetch(&db.keys_[batch[i].hash]);
+                __builtin_prefetch(&db.values_[batch[i].hash]);
+            }
+        }
+
+        for (size_t i = 0; i < cnt; ++i)
+            db.record(batch[i]);
+    }
+}
+
+// Args: stations. Depth 1 is the baseline without prefetching, the
+// cardinality decides whether the touched slots fit into L1, L2 or only L3.
+template <size_t Depth> static void BM_process_input(benchmark::State &state) {
+    auto data = load_fixture(state.range(0));
+    auto db = std::make_unique<DB>();
+
+    for (auto _ : state) {
+        process_input<Depth>(*db, data);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+static void cardinalities(benchmark::internal::Benchmark *bench) {
+    for (int64_t stations : {413, 2'000, 10'000, 40'000})
+        bench->Arg(stations);
+}
+
+BENCHMARK_TEMPLATE(BM_process_input, 1)->Apply(cardinalities);
+BENCHMARK_TEMPLATE(BM_process_input, 4)->Apply(cardinalities);
+BENCHMARK_TEMPLATE(BM_process_input, 8)->Apply(cardinalities);
+BENCHMARK_TEMPLATE(BM_process_input, 16)->Apply(cardinalities);
+BENCHMARK_TEMPLATE(BM_process_input, 32)->Apply(cardinalities);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,193 @@
+#include "bench_fixture.h"
+#include "shared_table.h"
+
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The per-thread table from 09_dynamic_chunks.cpp against the shared table
+// from 16_shared_table.cpp. Only the steady state record loop is measured,
+// the cost of allocating and merging the per-thread tables is covered by
+// BM_merge in bench_table.cpp and by the end-to-end runs.
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+// The fixture parsed upfront, the names point into "data"
+struct Parsed {
+    Parsed(size_t stations) : data(load_fixture(stations)) {
+        std::span<const char> input(data);
+        auto iter = input.begin();
+        while (iter != input.end())
+            rows.push_back(parse(iter));
+    }
+
+    // The rows of one of "threads" equal slices
+    std::span<const Measurement> slice(size_t idx, size_t threads) const {
+        size_t begin = rows.size() * idx / threads;
+        size_t end = rows.size() * (idx + 1) / threads;
+        return std::span(rows).subspan(begin, end - begin);
+    }
+
+    std::vector<char> data;
+    std::vector<Measurement> rows;
+};
+
+static std::unique_ptr<Parsed> input;
+static std::unique_ptr<SharedTable> shared;
+
+// Args: stations
+static void BM_per_thread(benchmark::State &state) {
+    if (state.thread_index() == 0)
+        input = std::make_unique<Parsed>(state.range(0));
+    auto db = std::make_unique<DB>();
+
+    std::span<const Measurement> rows;
+    for (auto _ : state) {
+        rows = input->slice(state.thread_index(), state.threads());
+        for (auto &m : rows)
+            db->record(m);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * rows.size());
+}
+BENCHMARK(BM_per_thread)
+    ->Arg(413)
+    ->Arg(10'000)
+    ->Arg(40'000)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+// Args: stations, stripes
+static void BM_shared(benchmark::State &state) {
+    if (state.thread_index() == 0) {
+        input = std::make_unique<Parsed>(state.range(0));
+        shared = std::make_unique<SharedTable>(state.range(1));
+    }
+
+    std::span<const Measurement> rows;
+    for (auto _ : state) {
+        rows = input->slice(state.thread_index(), state.threads());
+        for (auto &m : rows)
+            shared->record(m.name, m.hash, m.value, state.thread_index());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * rows.size());
+}
+BENCHMARK(BM_shared)
+    ->ArgsProduct({{413, 10'000, 40'000}, {1, 8}})
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
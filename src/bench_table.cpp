@@ -0,0 +1,243 @@
+#include "bench_fixture.h"
+
+#include <algorithm>
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The table and merge from 09_dynamic_chunks.cpp
+
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+std::unordered_map<std::string, Record>
+merge(std::span<const std::unique_ptr<DB>> dbs) {
+    std::unordered_map<std::string, Record> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk->filled_) {
+            auto it = merged.find(db_chunk->keys_[idx]);
+            if (it == merged.end()) {
+                merged.insert_or_assign(db_chunk->keys_[idx],
+                                        db_chunk->values_[idx]);
+            } else {
+                it->second.cnt += db_chunk->values_[idx].cnt;
+                it->second.sum += db_chunk->values_[idx].sum;
+                it->second.max =
+                    std::max(it->second.max, db_chunk->values_[idx].max);
+                it->second.min =
+                    std::min(it->second.min, db_chunk->values_[idx].min);
+            }
+        }
+    }
+    return merged;
+}
+
+// The fixture parsed upfront, the names point into "data"
+struct Parsed {
+    Parsed(size_t stations) : data(load_fixture(stations)) {
+        std::span<const char> input(data);
+        auto iter = input.begin();
+        while (iter != input.end())
+            rows.push_back(parse(iter));
+    }
+
+    std::vector<char> data;
+    std::vector<Measurement> rows;
+};
+
+uint16_t station_hash(std::string_view name) {
+    uint16_t hash = 0;
+    for (char c : name)
+        hash = hash * 7 + c;
+    return hash;
+}
+
+// Args: stations
+static void BM_record(benchmark::State &state) {
+    Parsed input(state.range(0));
+    auto db = std::make_unique<DB>();
+
+    for (auto _ : state) {
+        for (auto &m : input.rows)
+            db->record(m);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * input.rows.size());
+    state.SetBytesProcessed(state.iterations() * input.data.size());
+}
+BENCHMARK(BM_record)->Arg(413)->Arg(10'000)->Arg(40'000);
+
+// Args: stations, percentage of lookups that hit a station in the table
+static void BM_lookup_slot(benchmark::State &state) {
+    Parsed input(state.range(0));
+    auto db = std::make_unique<DB>();
+    for (auto &m : input.rows)
+        db->record(m);
+
+    // Misses are the same names with a suffix, so they hash into the same
+    // neighbourhood and walk similar probe chains.
+    int64_t hit_pct = state.range(1);
+    std::vector<std::string> missing;
+    for (auto idx : db->filled_)
+        missing.push_back(db->keys_[idx] + "~");
+    std::vector<Measurement> queries;
+    for (size_t i = 0; i < input.rows.size(); ++i) {
+        if (int64_t(i % 100) < hit_pct) {
+            queries.push_back(input.rows[i]);
+        } else {
+            std::string_view name = missing[i % missing.size()];
+            queries.push_back(Measurement{name, station_hash(name), 0});
+        }
+    }
+
+    for (auto _ : state) {
+        for (auto &q : queries) {
+            size_t slot = db->lookup_slot(q);
+            benchmark::DoNotOptimize(slot);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_lookup_slot)
+    ->ArgsProduct({{413, 10'000, 40'000}, {100, 90, 50, 0}});
+
+// Args: stations, number of per-thread tables
+static void BM_merge(benchmark::State &state) {
+    Parsed input(state.range(0));
+    size_t tables = state.range(1);
+
+    // Split the rows between the tables like the dynamic chunks would
+    std::vector<std::unique_ptr<DB>> dbs;
+    for (size_t i = 0; i < tables; ++i)
+        dbs.push_back(std::make_unique<DB>());
+    size_t per_table = (input.rows.size() + tables - 1) / tables;
+    for (size_t i = 0; i < input.rows.size(); ++i)
+        dbs[i / per_table]->record(input.rows[i]);
+
+    size_t entries = 0;
+    for (auto &db : dbs)
+        entries += db->filled_.size();
+
+    for (auto _ : state) {
+        auto merged = merge(dbs);
+        benchmark::DoNotOptimize(merged);
+    }
+    state.SetItemsProcessed(state.iterations() * entries);
+}
+BENCHMARK(BM_merge)
+    ->ArgsProduct({{413, 10'000, 40'000}, {1, 8, 32}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,197 @@
+// Perfect hash generator
+//
+// Reads a list of station names and writes a header with a minimal perfect
+// hash over them (hash and displace): every name falls into a bucket of
+// perfect_bucket(), and every bucket gets a displacement that moves its names
+// to free slots of perfect_slot(). Slot i of the generated "names" array holds
+// the name that maps to i, so a lookup is one hash evaluation and one compare.
+//
+// Usage: gen_perfect_hash [--names=FILE] [--out=station_table.h]
+//
+// FILE has one "name[;...]" per line (e.g. 1brc/data/weather_stations.csv),
+// lines starting with '#' are skipped. Without --names the table is empty and
+// all stations take the dynamic path.
+
+#include "station_hash.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+struct Options {
+    std::filesystem::path names;
+    std::filesystem::path out = "station_table.h";
+};
+
+static Options parse_options(int argc, char **argv) {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = arg.substr(arg.find('=') + 1);
+        if (arg.starts_with("--names="))
+            opts.names = value;
+        else if (arg.starts_with("--out="))
+            opts.out = value;
+        else
+            throw std::runtime_error("Unknown option " + std::string(arg));
+    }
+    return opts;
+}
+
+static std::vector<std::string> read_names(const std::filesystem::path &path) {
+    std::vector<std::string> names;
+    if (path.empty())
+        return names;
+
+    std::ifstream in(path);
+    if (not in)
+        throw std::runtime_error("Failed to open " + path.string());
+    std::unordered_set<std::string> seen;
+    std::string line;
+    while (std::getline(in, line)) {
+        auto name = line.substr(0, line.find(';'));
+        if (name.empty() || name.starts_with('#'))
+            continue;
+        if (seen.insert(name).second)
+            names.push_back(std::move(name));
+    }
+    return names;
+}
+
+struct PerfectHash {
+    std::vector<uint32_t> displacements;
+    // The index into the input names for every slot
+    std::vector<size_t> slots;
+};
+
+// Place the buckets largest first, each with the first displacement that
+// moves all of its names into distinct free slots.
+static std::optional<PerfectHash> search(const std::vector<uint64_t> &hashes,
+                                         size_t buckets) {
+    size_t n = hashes.size();
+    std::vector<std::vector<size_t>> members(buckets);
+    for (size_t i = 0; i < n; ++i)
+        members[perfect_bucket(hashes[i], buckets)].push_back(i);
+    std::vector<size_t> order(buckets);
+    for (size_t b = 0; b < buckets; ++b)
+        order[b] = b;
+    std::ranges::stable_sort(order, std::greater<>{},
+                             [&](size_t b) { return members[b].size(); });
+
+    PerfectHash result{std::vector<uint32_t>(buckets, 0),
+                       std::vector<size_t>(n, SIZE_MAX)};
+    // The last buckets only find one of a few free slots, the expected
+    // number of attempts is around n.
+    uint64_t attempts = std::max<uint64_t>(1 << 16, 64 * n);
+    std::vector<size_t> placed;
+    for (size_t b : order) {
+        if (members[b].empty())
+            break;
+        bool found = false;
+        for (uint32_t d = 0; d < attempts && not found; ++d) {
+            placed.clear();
+            found = true;
+            for (size_t i : members[b]) {
+                size_t slot = perfect_slot(hashes[i], d, n);
+                if (result.slots[slot] != SIZE_MAX ||
+                    std::ranges::find(placed, slot) != placed.end()) {
+                    found = false;
+                    break;
+                }
+                placed.push_back(slot);
+            }
+            if (found) {
+                result.displacements[b] = d;
+                for (size_t j = 0; j < placed.size(); ++j)
+                    result.slots[placed[j]] = members[b][j];
+            }
+        }
+        if (not found)
+            return std::nullopt;
+    }
+    return result;
+}
+
+// A C++ string literal, non-ASCII bytes as octal escapes
+static std::string literal(std::string_view name) {
+    std::string result = "\"";
+    for (unsigned char c : name) {
+        if (c >= 0x80 || c < 0x20 || c == '"' || c == '\\') {
+            result += '\\';
+            result += char('0' + (c >> 6));
+            result += char('0' + ((c >> 3) & 7));
+            result += char('0' + (c & 7));
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+static void write_header(std::ostream &out, const Options &opts,
+                         const std::vector<std::string> &names,
+                         const PerfectHash &table) {
+    out << "// Generated by gen_perfect_hash from "
+        << (opts.names.empty() ? "an empty list" : opts.names.string())
+        << ", do not edit\n\n"
+           "#pragma once\n\n"
+           "#include <array>\n"
+           "#include <cstddef>\n"
+           "#include <cstdint>\n"
+           "#include <string_view>\n\n"
+           "namespace known_stations {\n\n";
+    out << "inline constexpr size_t count = " << names.size() << ";\n\n";
+    out << "inline constexpr std::array<uint32_t, "
+        << table.displacements.size() << "> displacements = {";
+    for (size_t b = 0; b < table.displacements.size(); ++b)
+        out << (b % 16 == 0 ? "\n    " : " ") << table.displacements[b] << ",";
+    out << "\n};\n\n";
+    out << "inline constexpr std::array<std::string_view, " << names.size()
+        << "> names = {";
+    for (size_t slot : table.slots)
+        out << "\n    " << literal(names[slot]) << ",";
+    out << "\n};\n\n"
+           "} // namespace known_stations\n";
+}
+
+int main(int argc, char **argv) try {
+    Options opts = parse_options(argc, argv);
+    auto names = read_names(opts.names);
+
+    std::vector<uint64_t> hashes;
+    for (auto &name : names)
+        hashes.push_back(station_hash(name));
+
+    // Around four names per bucket keeps the table small, fewer names per
+    // bucket make the search easier if it fails.
+    std::optional<PerfectHash> table;
+    if (names.empty())
+        table = PerfectHash{{0}, {}};
+    for (size_t per_bucket : {4, 3, 2, 1}) {
+        if (table)
+            break;
+        table = search(hashes, names.size() / per_bucket + 1);
+    }
+    if (not table)
+        throw std::runtime_error("No perfect hash found, duplicate hashes?");
+
+    std::ofstream out(opts.out);
+    if (not out)
+        throw std::runtime_error("Failed to open " + opts.out.string());
+    write_header(out, opts, names, *table);
+
+    std::cerr << names.size() << " stations, "
+              << table->displacements.size() << " buckets\n";
+} catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,400 @@
+// Measurement generator
+//
+// Writes "station;value\n" rows using all cores. The output only depends on
+// the seed and the knobs, not on the number of threads: the station names are
+// generated upfront from the seed, and every block of rows has its own RNG
+// derived from the seed and the block index.
+//
+// Usage: generate [--rows=1000000000] [--stations=413] [--names=FILE]
+//            [--name-len=MIN-MAX] [--utf8=FRACTION] [--skew=S]
+//            [--values=MIN:MAX] [--stddev=10] [--seed=1] [--threads=N]
+//            [--out=measurements.txt]
+//
+// --names reads the station names from a file with one "name[;...]" per line
+// (e.g. 1brc/data/weather_stations.csv), otherwise random names are generated
+// with lengths uniform in MIN-MAX bytes, a FRACTION of them using multi-byte
+// UTF-8 characters. --skew is the Zipf exponent of the station frequencies
+// (0 is uniform). Each station gets a mean uniform in --values, the rows are
+// normally distributed around it and clamped to the range.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// xoshiro256** seeded through splitmix64
+struct Rng {
+    explicit Rng(uint64_t seed) {
+        for (auto &s : state_) {
+            seed += 0x9e3779b97f4a7c15;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            s = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t operator()() {
+        uint64_t result = std::rotl(state_[1] * 5, 7) * 9;
+        uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = std::rotl(state_[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, bound)
+    uint64_t below(uint64_t bound) {
+        return static_cast<uint64_t>(uniform() * bound);
+    }
+
+    // Uniform in [0, 1)
+    double uniform() { return ((*this)() >> 11) * 0x1.0p-53; }
+
+  private:
+    uint64_t state_[4];
+};
+
+struct Options {
+    uint64_t rows = 1'000'000'000;
+    size_t stations = 413;
+    std::filesystem::path names;
+    size_t min_name = 3;
+    size_t max_name = 24;
+    double utf8 = 0.0;
+    double skew = 0.0;
+    int min_value = -999;
+    int max_value = 999;
+    double stddev = 10.0;
+    uint64_t seed = 1;
+    size_t threads = std::thread::hardware_concurrency();
+    std::filesystem::path out = "measurements.txt";
+};
+
+// Append a random character that is exactly "bytes" long in UTF-8
+static void append_char(std::string &name, size_t bytes, Rng &rng) {
+    static constexpr char letters[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    uint32_t cp = 0;
+    switch (bytes) {
+    case 1:
+        name.push_back(letters[rng.below(sizeof(letters) - 1)]);
+        return;
+    case 2: // Latin-1 Supplement and Latin Extended-A
+        cp = 0xC0 + rng.below(0x180 - 0xC0);
+        name.push_back(0xC0 | (cp >> 6));
+        break;
+    case 3: // CJK Unified Ideographs
+        cp = 0x4E00 + rng.below(0x9FFF - 0x4E00);
+        name.push_back(0xE0 | (cp >> 12));
+        name.push_back(0x80 | ((cp >> 6) & 0x3F));
+        break;
+    default: // Supplementary Multilingual Plane symbols
+        cp = 0x1F300 + rng.below(0x1F5FF - 0x1F300);
+        name.push_back(0xF0 | (cp >> 18));
+        name.push_back(0x80 | ((cp >> 12) & 0x3F));
+        name.push_back(0x80 | ((cp >> 6) & 0x3F));
+        break;
+    }
+    name.push_back(0x80 | (cp & 0x3F));
+}
+
+static std::string random_name(const Options &opts, Rng &rng) {
+    size_t len = opts.min_name + rng.below(opts.max_name - opts.min_name + 1);
+    bool multibyte = rng.uniform() < opts.utf8;
+    std::string name;
+    while (name.size() < len) {
+        size_t left = len - name.size();
+        size_t bytes = multibyte ? 1 + rng.below(std::min<size_t>(left, 4)) : 1;
+        append_char(name, bytes, rng);
+    }
+    return name;
+}
+
+static std::vector<std::string> station_names(const Options &opts, Rng &rng) {
+    std::vector<std::string> names;
+    std::unordered_set<std::string> seen;
+    if (not opts.names.empty()) {
+        std::ifstream in(opts.names);
+        if (not in)
+            throw std::runtime_error("Failed to open " + opts.names.string());
+        std::string line;
+        while (names.size() < opts.stations && std::getline(in, line)) {
+            auto name = line.substr(0, line.find(';'));
+            if (name.empty() || name.starts_with('#'))
+                continue;
+            if (seen.insert(name).second)
+                names.push_back(std::move(name));
+        }
+        return names;
+    }
+
+    size_t attempts = 0;
+    while (names.size() < opts.stations) {
+        auto name = random_name(opts, rng);
+        if (seen.insert(name).second)
+            names.push_back(std::move(name));
+        else if (++attempts > 100 * opts.stations)
+            throw std::runtime_error(
+                "Can't generate enough unique names, widen --name-len");
+    }
+    return names;
+}
+
+// Vose's alias method, constant time sampling from the Zipf distribution
+struct AliasTable {
+    AliasTable(size_t n, double skew) : prob_(n), alias_(n) {
+        std::vector<double> weights(n);
+        double total = 0;
+        for (size_t i = 0; i < n; ++i)
+            total += weights[i] = 1.0 / std::pow(double(i + 1), skew);
+
+        std::vector<size_t> small, large;
+        for (size_t i = 0; i < n; ++i) {
+            weights[i] *= n / total;
+            (weights[i] < 1.0 ? small : large).push_back(i);
+        }
+        while (not small.empty() && not large.empty()) {
+            size_t s = small.back(), l = large.back();
+            small.pop_back();
+            prob_[s] = weights[s];
+            alias_[s] = l;
+            weights[l] -= 1.0 - weights[s];
+            if (weights[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        for (auto i : small)
+            prob_[i] = 1.0;
+        for (auto i : large)
+            prob_[i] = 1.0;
+    }
+
+    size_t sample(Rng &rng) const {
+        size_t idx = rng.below(prob_.size());
+        return rng.uniform() < prob_[idx] ? idx : alias_[idx];
+    }
+
+  private:
+    std::vector<double> prob_;
+    std::vector<uint32_t> alias_;
+};
+
+// Everything a row needs, pre-formatted
+struct Dictionary {
+    Dictionary(const Options &opts, Rng &rng) {
+        auto names = station_names(opts, rng);
+        for (auto &name : names) {
+            offsets.push_back(text.size());
+            text += name;
+            text += ';';
+        }
+        offsets.push_back(text.size());
+        for (size_t i = 0; i < names.size(); ++i)
+            means.push_back(opts.min_value +
+                            rng.below(opts.max_value - opts.min_value + 1));
+
+        for (int v = -999; v <= 999; ++v) {
+            auto &entry = values[v + 999];
+            int abs = v < 0 ? -v : v;
+            char *out = entry.data();
+            if (v < 0)
+                *out++ = '-';
+            if (abs >= 100)
+                *out++ = '0' + abs / 100;
+            *out++ = '0' + abs / 10 % 10;
+            *out++ = '.';
+            *out++ = '0' + abs % 10;
+            *out++ = '\n';
+            entry.back() = out - entry.data();
+        }
+    }
+
+    size_t size() const { return means.size(); }
+    std::string_view name(size_t idx) const {
+        return std::string_view(text).substr(offsets[idx],
+                                             offsets[idx + 1] - offsets[idx]);
+    }
+
+    // "name;" for all stations back to back
+    std::string text;
+    std::vector<size_t> offsets;
+    std::vector<int> means;
+    // "-99.9\n" ... "99.9\n", the last byte holds the length
+    std::array<std::array<char, 8>, 1999> values;
+};
+
+static constexpr uint64_t block_rows = 1 << 16;
+
+static void format_block(const Options &opts, const Dictionary &dict,
+                         const AliasTable &stations, uint64_t block,
+                         std::vector<char> &buffer) {
+    Rng rng(opts.seed ^ (block + 1) * 0xd1b54a32d192ed03);
+    uint64_t rows = std::min(block_rows, opts.rows - block * block_rows);
+    // Sum of four uniforms on [-sqrt(3), sqrt(3)] has unit variance
+    double scale = opts.stddev * 10 * std::sqrt(3.0) / 2;
+
+    buffer.clear();
+    for (uint64_t i = 0; i < rows; ++i) {
+        size_t idx = opts.skew == 0.0 ? rng.below(dict.size())
+                                      : stations.sample(rng);
+        double noise = (rng.uniform() + rng.uniform() + rng.uniform() +
+                        rng.uniform() - 2.0) *
+                       scale;
+        int value = std::clamp(dict.means[idx] + int(std::lround(noise)),
+                               opts.min_value, opts.max_value);
+
+        auto name = dict.name(idx);
+        auto &formatted = dict.values[value + 999];
+        buffer.insert(buffer.end(), name.begin(), name.end());
+        buffer.insert(buffer.end(), formatted.begin(),
+                      formatted.begin() + formatted.back());
+    }
+}
+
+// Blocks are formatted in parallel, each thread reserves the file offset of
+// its block in order and then writes it without further synchronization.
+static uint64_t generate(const Options &opts, const Dictionary &dict, int fd) {
+    AliasTable stations(dict.size(), opts.skew);
+    uint64_t blocks = (opts.rows + block_rows - 1) / block_rows;
+
+    std::atomic<uint64_t> next_block = 0;
+    std::mutex mux;
+    std::condition_variable turn_cv;
+    uint64_t turn = 0;
+    uint64_t offset = 0;
+    std::exception_ptr error;
+
+    std::vector<std::jthread> workers;
+    for (size_t t = 0; t < std::max<size_t>(opts.threads, 1); ++t) {
+        workers.emplace_back([&] {
+            std::vector<char> buffer;
+            for (uint64_t block = next_block++; block < blocks;
+                 block = next_block++) {
+                format_block(opts, dict, stations, block, buffer);
+
+                uint64_t at = 0;
+                {
+                    std::unique_lock lock(mux);
+                    turn_cv.wait(lock, [&] { return turn == block; });
+                    at = offset;
+                    offset += buffer.size();
+                    ++turn;
+                }
+                turn_cv.notify_all();
+
+                for (size_t done = 0; done < buffer.size();) {
+                    ssize_t ret = pwrite(fd, buffer.data() + done,
+                                         buffer.size() - done, at + done);
+                    if (ret < 0) {
+                        std::lock_guard lock(mux);
+                        error = std::make_exception_ptr(std::system_error(
+                            errno, std::system_category(),
+                            "Failed to write output"));
+                        break;
+                    }
+                    done += ret;
+                }
+            }
+        });
+    }
+    workers.clear(); // join threads
+    if (error)
+        std::rethrow_exception(error);
+    return offset;
+}
+
+static Options parse_options(int argc, char **argv) {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto eq = arg.find('=');
+        auto name = arg.substr(0, eq);
+        std::string value(eq == arg.npos ? "" : arg.substr(eq + 1));
+        if (name == "--rows")
+            opts.rows = std::stoull(value);
+        else if (name == "--stations")
+            opts.stations = std::stoull(value);
+        else if (name == "--names")
+            opts.names = value;
+        else if (name == "--name-len") {
+            auto dash = value.find('-');
+            opts.min_name = std::stoull(value.substr(0, dash));
+            opts.max_name = dash == value.npos
+                                ? opts.min_name
+                                : std::stoull(value.substr(dash + 1));
+        } else if (name == "--utf8")
+            opts.utf8 = std::stod(value);
+        else if (name == "--skew")
+            opts.skew = std::stod(value);
+        else if (name == "--values") {
+            auto colon = value.find(':');
+            opts.min_value = std::lround(std::stod(value.substr(0, colon)) * 10);
+            opts.max_value = std::lround(std::stod(value.substr(colon + 1)) * 10);
+        } else if (name == "--stddev")
+            opts.stddev = std::stod(value);
+        else if (name == "--seed")
+            opts.seed = std::stoull(value);
+        else if (name == "--threads")
+            opts.threads = std::stoull(value);
+        else if (name == "--out")
+            opts.out = value;
+        else
+            throw std::runtime_error("Unknown option " + std::string(arg));
+    }
+    if (opts.stations == 0 || opts.min_name == 0 ||
+        opts.min_name > opts.max_name || opts.max_name > 100)
+        throw std::runtime_error("Names must be 1-100 bytes long");
+    if (opts.min_value < -999 || opts.max_value > 999 ||
+        opts.min_value > opts.max_value)
+        throw std::runtime_error("Values must be within -99.9:99.9");
+    return opts;
+}
+
+int main(int argc, char **argv) try {
+    Options opts = parse_options(argc, argv);
+
+    auto start = std::chrono::steady_clock::now();
+    Rng rng(opts.seed);
+    Dictionary dict(opts, rng);
+
+    int fd = open(opts.out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        throw std::system_error(errno, std::system_category(),
+                                "Failed to open " + opts.out.string());
+    uint64_t bytes = generate(opts, dict, fd);
+    close(fd);
+
+    double secs = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    std::cerr << opts.rows << " rows, " << dict.size() << " stations, "
+              << bytes << " bytes in " << secs << "s (" << bytes / secs / 1e9
+              << " GB/s)\n";
+} catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,569 @@
+// End-to-end benchmark driver
+//
+// Runs the variant executables over a set of datasets, sweeping the thread
+// count and chunk size where the variant supports them. Every run is checked
+// against a golden output, the timings are summarized as median/p95 wall time
+// and GB/s and written out as CSV. Given a stored baseline CSV, any
+// configuration that got slower by more than the measured noise is flagged.
+// A run that fails or exceeds the timeout is recorded as such and the
+// remaining configurations still run.
+//
+// Usage: run_benchmarks [--datasets=a.txt,b.txt] [--generate=1000000x413,...]
+//            [--data-dir=datasets] [--variants=09_dynamic_chunks]
+//            [--threads=1,2,4] [--chunk-mb=16,64] [--repeat=5] [--warmup=1]
+//            [--bin-dir=DIR] [--reference=05_fixed_point] [--out=results.csv]
+//            [--baseline=baseline.csv] [--tolerance=0.05] [--timeout=600]
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <poll.h>
+#include <signal.h>
+#include <string>
+#include <string_view>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// How a variant expects to be invoked: "prog [threads] [chunk_mb]"
+struct Variant {
+    std::string_view name;
+    bool threads;
+    bool chunk_size;
+    // The floating point variants round the mean differently, so a mismatch
+    // is reported but doesn't fail the run.
+    bool exact;
+    // The fixed table of 09_dynamic_chunks (and its descendants) has 65536
+    // slots and never terminates with more stations, such datasets are
+    // skipped for these variants.
+    bool fixed_table;
+};
+
+static constexpr size_t fixed_table_slots = 65536;
+
+static constexpr Variant known_variants[] = {
+    {"01_baseline", false, false, false, false},
+    {"02_mmap", false, false, false, false},
+    {"03_copies", false, false, false, false},
+    {"04_refactor", false, false, false, false},
+    {"05_fixed_point", false, false, true, false},
+    {"06_custom_hash", false, false, true, true},
+    {"07_better_parsing", false, false, true, true},
+    {"08_chunks", true, false, true, true},
+    {"09_dynamic_chunks", true, true, true, true},
+    {"10_aggregate_policy", true, true, true, true},
+    {"11_planner", true, true, true, false},
+    {"12_cpu_dispatch", true, true, true, false},
+    {"13_batch_parse", true, true, true, false},
+    {"14_prefetch", true, true, true, true},
+    {"15_perfect_hash", true, true, true, true},
+    {"16_shared_table", true, true, true, true},
+    {"17_arena", true, true, true, true},
+    {"18_compressed", true, true, true, true},
+    {"20_tolerant", true, true, true, false},
+    {"21_schema", true, true, true, true},
+    {"24_auto_threads", true, true, true, true},
+    {"25_hash_policy", true, true, true, true},
+    {"26_multi_cursor", true, true, true, true},
+    {"27_multi_query", true, true, true, true},
+    {"28_partitioned", true, true, true, true},
+    {"29_scheduler", true, true, true, true},
+    {"30_parallel_output", true, true, true, false},
+};
+
+struct Options {
+    fs::path bin_dir;
+    std::vector<std::string> variants;
+    std::vector<fs::path> datasets;
+    std::vector<std::string> generate;
+    fs::path data_dir = "datasets";
+    std::vector<size_t> threads = {1};
+    std::vector<size_t> chunk_mb = {64};
+    size_t repeat = 5;
+    size_t warmup = 1;
+    std::string reference = "05_fixed_point";
+    fs::path out = "results.csv";
+    std::optional<fs::path> baseline;
+    double tolerance = 0.05;
+    // Seconds before a single run of a variant is killed
+    double timeout = 600;
+};
+
+struct Result {
+    std::string variant;
+    std::string dataset;
+    uint64_t bytes;
+    size_t threads;
+    size_t chunk_mb;
+    size_t runs;
+    double median;
+    double p95;
+    double min;
+    bool correct;
+    // "ok", or "failed"/"timeout" if a run didn't finish, the timings are
+    // zero then
+    std::string status = "ok";
+
+    bool ok() const { return status == "ok"; }
+    double gbps() const { return ok() ? bytes / median / 1e9 : 0; }
+};
+
+// A variant run that exited with an error or was killed after the timeout
+struct RunError : std::runtime_error {
+    RunError(const std::string &what, bool timed_out)
+        : std::runtime_error(what), timed_out(timed_out) {}
+
+    bool timed_out;
+};
+
+static std::vector<std::string> split(std::string_view list, char delim) {
+    std::vector<std::string> result;
+    while (not list.empty()) {
+        auto pos = list.find(delim);
+        result.emplace_back(list.substr(0, pos));
+        if (pos == list.npos)
+            break;
+        list.remove_prefix(pos + 1);
+    }
+    return result;
+}
+
+static std::vector<size_t> split_numbers(std::string_view list) {
+    std::vector<size_t> result;
+    for (auto &item : split(list, ','))
+        result.push_back(std::stoull(item));
+    return result;
+}
+
+static std::string read_file(const fs::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>()};
+}
+
+// The variants read "measurements.txt" from the working directory, so each
+// dataset gets its own directory with a symlink to the actual file.
+struct Workdir {
+    Workdir(const fs::path &dataset) {
+        std::string templ =
+            (fs::temp_directory_path() / "1brc_bench_XXXXXX").string();
+        if (mkdtemp(templ.data()) == nullptr)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to create working directory");
+        path_ = templ;
+        fs::create_symlink(fs::absolute(dataset), path_ / "measurements.txt");
+    }
+    ~Workdir() {
+        std::error_code ec;
+        fs::remove_all(path_, ec);
+    }
+    Workdir(const Workdir &) = delete;
+    Workdir &operator=(const Workdir &) = delete;
+
+    const fs::path &path() const { return path_; }
+    fs::path output() const { return path_ / "output.txt"; }
+
+  private:
+    fs::path path_;
+};
+
+// Wait for the child to exit and return its status, or kill it and return
+// nothing once the timeout (in seconds, 0 for none) expires. The pidfd becomes
+// readable as soon as the child exits, so there is no polling delay that
+// would skew the measured time.
+static std::optional<int> wait_child(pid_t pid, double timeout) {
+    if (timeout > 0) {
+        int pidfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+        if (pidfd == -1) {
+            int err = errno;
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            throw std::system_error(err, std::system_category(),
+                                    "pidfd_open failed");
+        }
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration<double>(timeout);
+        pollfd pfd{pidfd, POLLIN, 0};
+        int ready;
+        do {
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            ready = poll(&pfd, 1,
+                         std::clamp<int64_t>(left.count(), 0, INT_MAX));
+        } while (ready == -1 && errno == EINTR);
+        close(pidfd);
+        if (ready == 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            return std::nullopt;
+        }
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) == -1)
+        throw std::system_error(errno, std::system_category(),
+                                "waitpid failed");
+    return status;
+}
+
+// Run the executable inside the directory with its stdout redirected into
+// the output file, returns the wall time in seconds.
+static double spawn(const fs::path &exe, const std::vector<std::string> &args,
+                    const fs::path &cwd, const fs::path &output,
+                    double timeout) {
+    std::vector<char *> argv;
+    std::string exe_str = exe.string();
+    argv.push_back(exe_str.data());
+    std::vector<std::string> args_copy = args;
+    for (auto &arg : args_copy)
+        argv.push_back(arg.data());
+    argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == -1)
+        throw std::system_error(errno, std::system_category(), "fork failed");
+    if (pid == 0) {
+        int fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1 || dup2(fd, STDOUT_FILENO) == -1 ||
+            chdir(cwd.c_str()) == -1)
+            _exit(127);
+        close(fd);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    auto status = wait_child(pid, timeout);
+    auto end = std::chrono::steady_clock::now();
+    if (not status)
+        throw RunError(exe.filename().string() + " timed out", true);
+    if (not WIFEXITED(*status) || WEXITSTATUS(*status) != 0)
+        throw RunError(exe.filename().string() + " failed", false);
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static double run_once(const fs::path &exe, const std::vector<std::string> &args,
+                       const Workdir &dir, double timeout) {
+    return spawn(exe, args, dir.path(), dir.output(), timeout);
+}
+
+// Generated datasets are described as ROWSxSTATIONS[xSKEW] and cached in the
+// data directory, the generator is deterministic so the cache stays valid.
+static fs::path generated_dataset(const fs::path &bin_dir,
+                                  const fs::path &data_dir,
+                                  std::string_view spec) {
+    auto parts = split(spec, 'x');
+    if (parts.size() < 2 || parts.size() > 3)
+        throw std::runtime_error("Invalid dataset spec " + std::string(spec));
+    std::string name = "gen_" + parts[0] + "_" + parts[1];
+    std::vector<std::string> args = {"--rows=" + parts[0],
+                                      "--stations=" + parts[1]};
+    if (parts.size() == 3) {
+        name += "_zipf" + parts[2];
+        args.push_back("--skew=" + parts[2]);
+    }
+    fs::path dataset = fs::absolute(data_dir / (name + ".txt"));
+    if (not fs::exists(dataset)) {
+        fs::create_directories(data_dir);
+        std::cerr << "Generating " << dataset << "\n";
+        args.push_back("--out=" + dataset.string());
+        spawn(bin_dir / "generate", args, fs::current_path(), "/dev/null", 0);
+    }
+    return dataset;
+}
+
+// Nearest-rank percentile of a sorted sample
+static double percentile(const std::vector<double> &sorted, double p) {
+    size_t rank = static_cast<size_t>(p * sorted.size() + 0.999999);
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// The golden output lives next to the dataset, if missing it is produced
+// once by the reference variant.
+static std::string golden_output(const Options &opts, const fs::path &dataset,
+                                 const Workdir &dir) {
+    fs::path golden = dataset;
+    golden += ".golden";
+    if (not fs::exists(golden)) {
+        std::cerr << "Generating " << golden << " using " << opts.reference
+                  << "\n";
+        run_once(opts.bin_dir / opts.reference, {}, dir, opts.timeout);
+        fs::copy_file(dir.output(), golden);
+    }
+    return read_file(golden);
+}
+
+// The number of stations in an output "{a=1.0/2.0/3.0, b=...}\n", as an
+// upper bound (a name could contain ", ")
+static size_t output_stations(std::string_view output) {
+    if (output.find('=') == output.npos)
+        return 0;
+    size_t stations = 1;
+    for (size_t pos = output.find(", "); pos != output.npos;
+         pos = output.find(", ", pos + 2))
+        ++stations;
+    return stations;
+}
+
+static Result measure(const Options &opts, const Variant &variant,
+                      const fs::path &dataset, const Workdir &dir,
+                      const std::string &golden, size_t threads,
+                      size_t chunk_mb) {
+    std::vector<std::string> args;
+    if (variant.threads)
+        args.push_back(std::to_string(threads));
+    if (variant.chunk_size)
+        args.push_back(std::to_string(chunk_mb));
+
+    auto exe = opts.bin_dir / variant.name;
+    Result result{std::string(variant.name),
+                  dataset.filename().string(),
+                  fs::file_size(dataset),
+                  variant.threads ? threads : 1,
+                  variant.chunk_size ? chunk_mb : 0,
+                  opts.repeat,
+                  0,
+                  0,
+                  0,
+                  true};
+    std::vector<double> times;
+    try {
+        for (size_t i = 0; i < opts.warmup; ++i)
+            run_once(exe, args, dir, opts.timeout);
+        for (size_t i = 0; i < opts.repeat; ++i) {
+            times.push_back(run_once(exe, args, dir, opts.timeout));
+            result.correct &= (read_file(dir.output()) == golden);
+        }
+    } catch (const RunError &e) {
+        std::cerr << e.what() << "\n";
+        result.runs = times.size();
+        result.correct = false;
+        result.status = e.timed_out ? "timeout" : "failed";
+        return result;
+    }
+    std::ranges::sort(times);
+    result.median = percentile(times, 0.5);
+    result.p95 = percentile(times, 0.95);
+    result.min = times.front();
+    return result;
+}
+
+static const char *csv_header =
+    "variant,dataset,bytes,threads,chunk_mb,runs,median_s,p95_s,min_s,gbps,"
+    "correct,status";
+
+static void write_csv(const fs::path &path, const std::vector<Result> &results) {
+    std::ofstream out(path);
+    out << csv_header << "\n";
+    out << std::setprecision(6);
+    for (auto &r : results)
+        out << r.variant << "," << r.dataset << "," << r.bytes << ","
+            << r.threads << "," << r.chunk_mb << "," << r.runs << ","
+            << r.median << "," << r.p95 << "," << r.min << "," << r.gbps()
+            << "," << r.correct << "," << r.status << "\n";
+}
+
+static std::vector<Result> read_csv(const fs::path &path) {
+    std::ifstream in(path);
+    if (not in)
+        throw std::runtime_error("Failed to open baseline " + path.string());
+    std::vector<Result> results;
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line)) {
+        // Baselines written before the status column was added have 11
+        auto f = split(line, ',');
+        if (f.size() != 11 && f.size() != 12)
+            continue;
+        results.push_back(Result{f[0], f[1], std::stoull(f[2]),
+                                 std::stoull(f[3]), std::stoull(f[4]),
+                                 std::stoull(f[5]), std::stod(f[6]),
+                                 std::stod(f[7]), std::stod(f[8]),
+                                 f[10] == "1", f.size() == 12 ? f[11] : "ok"});
+    }
+    return results;
+}
+
+// A configuration regressed if its median is slower than the baseline by
+// more than the tolerance or the observed spread (p95 vs median) of either
+// measurement, whichever is larger. Runs that didn't finish have no timings
+// to compare.
+static size_t compare_baseline(const std::vector<Result> &results,
+                               const std::vector<Result> &baseline,
+                               double tolerance) {
+    auto key = [](const Result &r) {
+        return std::make_tuple(r.variant, r.dataset, r.threads, r.chunk_mb);
+    };
+    std::map<std::tuple<std::string, std::string, size_t, size_t>,
+             const Result *>
+        base;
+    for (auto &r : baseline)
+        base.emplace(key(r), &r);
+
+    size_t regressions = 0;
+    for (auto &r : results) {
+        auto it = base.find(key(r));
+        if (it == base.end() || not r.ok() || not it->second->ok())
+            continue;
+        const Result &b = *it->second;
+        double noise = std::max((r.p95 - r.median) / r.median,
+                                (b.p95 - b.median) / b.median);
+        double limit = 1.0 + std::max(tolerance, noise);
+        double ratio = r.median / b.median;
+        if (ratio > limit) {
+            ++regressions;
+            std::cout << "REGRESSION " << r.variant << " " << r.dataset
+                      << " threads=" << r.threads
+                      << " chunk_mb=" << r.chunk_mb << ": " << std::fixed
+                      << std::setprecision(3) << b.median << "s -> "
+                      << r.median << "s (x" << ratio << ", limit x" << limit
+                      << ")\n";
+        }
+    }
+    return regressions;
+}
+
+static Options parse_options(int argc, char **argv) {
+    Options opts;
+    opts.bin_dir = fs::canonical("/proc/self/exe").parent_path();
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto eq = arg.find('=');
+        auto name = arg.substr(0, eq);
+        auto value = eq == arg.npos ? std::string_view{} : arg.substr(eq + 1);
+        if (name == "--bin-dir")
+            opts.bin_dir = fs::absolute(value);
+        else if (name == "--variants")
+            opts.variants = split(value, ',');
+        else if (name == "--datasets")
+            for (auto &d : split(value, ','))
+                opts.datasets.emplace_back(d);
+        else if (name == "--generate")
+            opts.generate = split(value, ',');
+        else if (name == "--data-dir")
+            opts.data_dir = value;
+        else if (name == "--threads")
+            opts.threads = split_numbers(value);
+        else if (name == "--chunk-mb")
+            opts.chunk_mb = split_numbers(value);
+        else if (name == "--repeat")
+            opts.repeat = std::max<size_t>(1, std::stoull(std::string(value)));
+        else if (name == "--warmup")
+            opts.warmup = std::stoull(std::string(value));
+        else if (name == "--reference")
+            opts.reference = value;
+        else if (name == "--out")
+            opts.out = value;
+        else if (name == "--baseline")
+            opts.baseline = value;
+        else if (name == "--tolerance")
+            opts.tolerance = std::stod(std::string(value));
+        else if (name == "--timeout")
+            opts.timeout = std::stod(std::string(value));
+        else
+            throw std::runtime_error("Unknown option " + std::string(arg));
+    }
+    if (opts.variants.empty())
+        for (auto &v : known_variants)
+            opts.variants.emplace_back(v.name);
+    for (auto &spec : opts.generate)
+        opts.datasets.push_back(
+            generated_dataset(opts.bin_dir, opts.data_dir, spec));
+    if (opts.datasets.empty())
+        throw std::runtime_error("No datasets given (--datasets=a.txt,... or "
+                                 "--generate=ROWSxSTATIONS,...)");
+    return opts;
+}
+
+static void print_result(const Result &r, const Variant &variant) {
+    std::cout << std::left << std::setw(22) << r.variant << std::setw(32)
+              << r.dataset << " threads=" << std::setw(4) << r.threads
+              << " chunk_mb=" << std::setw(4) << r.chunk_mb << std::right;
+    if (not r.ok()) {
+        std::cout << " " << (r.status == "timeout" ? "TIMED OUT" : "FAILED")
+                  << "\n";
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(3) << " median=" << r.median
+              << "s p95=" << r.p95 << "s " << std::setprecision(2) << r.gbps()
+              << " GB/s"
+              << (r.correct        ? ""
+                  : variant.exact ? " WRONG OUTPUT"
+                                  : " (inexact output)")
+              << "\n";
+}
+
+int main(int argc, char **argv) try {
+    Options opts = parse_options(argc, argv);
+
+    std::vector<Variant> variants;
+    for (auto &name : opts.variants) {
+        auto it = std::ranges::find(known_variants, name, &Variant::name);
+        if (it == std::end(known_variants))
+            throw std::runtime_error("Unknown variant " + name);
+        variants.push_back(*it);
+    }
+
+    std::vector<Result> results;
+    bool all_correct = true;
+    for (auto &dataset : opts.datasets) {
+        // A dataset that can't be set up doesn't lose the results so far
+        try {
+            Workdir dir(dataset);
+            auto golden = golden_output(opts, dataset, dir);
+            size_t stations = output_stations(golden);
+
+            for (auto &variant : variants) {
+                if (variant.fixed_table && stations > fixed_table_slots) {
+                    std::cout << std::left << std::setw(22) << variant.name
+                              << std::setw(32) << dataset.filename().string()
+                              << std::right << " skipped, " << stations
+                              << " stations don't fit the fixed table\n";
+                    continue;
+                }
+                // Single threaded variants don't take the sweep parameters
+                auto threads = variant.threads ? opts.threads
+                                               : std::vector<size_t>{1};
+                auto chunk_mb = variant.chunk_size ? opts.chunk_mb
+                                                   : std::vector<size_t>{0};
+                for (auto t : threads) {
+                    for (auto c : chunk_mb) {
+                        auto r = measure(opts, variant, dataset, dir, golden,
+                                         t, c);
+                        print_result(r, variant);
+                        all_correct &=
+                            r.ok() && (r.correct || not variant.exact);
+                        results.push_back(std::move(r));
+                    }
+                }
+            }
+        } catch (const std::exception &e) {
+            std::cerr << dataset.string() << ": " << e.what() << "\n";
+            all_correct = false;
+        }
+    }
+    write_csv(opts.out, results);
+
+    size_t regressions = 0;
+    if (opts.baseline)
+        regressions = compare_baseline(results, read_csv(*opts.baseline),
+                                       opts.tolerance);
+
+    return (all_correct && regressions == 0) ? 0 : 1;
+} catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 2;
+}
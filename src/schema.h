@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string_view>
+#include <utility>
+
+// Compile-time record schemas
+//
+// A schema describes the lines of a feed: the delimiter between the columns,
+// the column with the station name, and the fixed-point value columns with
+// their number of decimals. Everything is a template parameter, so parse()
+// unrolls into straight-line code for exactly these columns (no column loop,
+// no delimiter lookup at runtime) and the record keeps one set of aggregates
+// per value column.
+//
+//   // station;temp;humidity;pressure
+//   using Weather = Schema<';', 0, FixedPoint<1, 1>, FixedPoint<2, 1>,
+//                          FixedPoint<3, 1>>;
+//
+// Columns that are neither the key nor a value are skipped, as is anything
+// after the last column the schema refers to.
+
+// A value column with "Decimals" digits after the '.', stored as an integer
+// in units of 10^-Decimals
+template <size_t Column, size_t Decimals> struct FixedPoint {
+    static_assert(Decimals <= 6);
+    static constexpr size_t column = Column;
+    static constexpr size_t decimals = Decimals;
+};
+
+template <char Delimiter, size_t KeyColumn, typename... Values> struct Schema {
+    static_assert(sizeof...(Values) > 0, "A schema needs a value column");
+    static_assert(Delimiter != '\n' && Delimiter != '-' && Delimiter != '.' &&
+                  (Delimiter < '0' || Delimiter > '9'));
+
+    static constexpr char delimiter = Delimiter;
+    static constexpr size_t key_column = KeyColumn;
+    static constexpr size_t values = sizeof...(Values);
+    static constexpr size_t columns =
+        std::max({KeyColumn, Values::column...}) + 1;
+    static constexpr std::array<size_t, values> decimals = {
+        Values::decimals...};
+
+    static constexpr size_t none = SIZE_MAX;
+    // The index of the value stored from each column, or none
+    static constexpr std::array<size_t, columns> value_index = [] {
+        std::array<size_t, columns> result;
+        result.fill(none);
+        size_t idx = 0;
+        ((result[Values::column] = idx++), ...);
+        return result;
+    }();
+
+    static_assert(value_index[KeyColumn] == none,
+                  "The key column can't be a value column");
+    static_assert(((value_index[Values::column] != none) && ...));
+    static_assert(std::ranges::count_if(value_index, [](size_t idx) {
+                      return idx != none;
+                  }) == values,
+                  "Duplicate value column");
+};
+
+template <typename S> struct Row {
+    std::string_view name;
+    uint16_t hash;
+    std::array<int32_t, S::values> value;
+};
+
+// Parse "-?d+.d{Decimals}", stops at the first byte after the last decimal
+template <size_t Decimals> int32_t parse_fixed(const char *&ptr) {
+    bool negative = *ptr == '-';
+    ptr += negative;
+    int32_t result = 0;
+    while (static_cast<unsigned char>(*ptr - '0') < 10)
+        result = result * 10 + (*ptr++ - '0');
+    if constexpr (Decimals > 0) {
+        ++ptr; // '.'
+        for (size_t i = 0; i < Decimals; ++i)
+            result = result * 10 + (*ptr++ - '0');
+    }
+    return negative ? -result : result;
+}
+
+template <typename S, size_t Column>
+void parse_column(const char *&ptr, Row<S> &row) {
+    // The last column used by the schema also ends at the end of the line
+    constexpr bool last = Column + 1 == S::columns;
+    auto at_end = [](char c) {
+        return c == S::delimiter || (last && c == '\n');
+    };
+
+    if constexpr (Column == S::key_column) {
+        const char *begin = ptr;
+        row.hash = 0;
+        while (not at_end(*ptr)) {
+            row.hash = row.hash * 7 + *ptr;
+            ++ptr;
+        }
+        row.name = {begin, ptr};
+    } else if constexpr (S::value_index[Column] != S::none) {
+        constexpr size_t idx = S::value_index[Column];
+        row.value[idx] = parse_fixed<S::decimals[idx]>(ptr);
+    } else {
+        while (not at_end(*ptr))
+            ++ptr;
+    }
+
+    if constexpr (last) {
+        // Skip any columns the schema doesn't refer to
+        while (*ptr != '\n')
+            ++ptr;
+    }
+    ++ptr;
+}
+
+template <typename S> Row<S> parse(const char *&ptr) {
+    Row<S> row;
+    [&]<size_t... Column>(std::index_sequence<Column...>) {
+        (parse_column<S, Column>(ptr, row), ...);
+    }(std::make_index_sequence<S::columns>{});
+    return row;
+}
+
+// min/mean/max for every value column
+template <typename S> struct Record {
+    int64_t cnt;
+    std::array<int64_t, S::values> sum;
+
+    std::array<int32_t, S::values> min;
+    std::array<int32_t, S::values> max;
+
+    static Record init(const Row<S> &row) {
+        Record result;
+        result.cnt = 1;
+        for (size_t i = 0; i < S::values; ++i) {
+            result.sum[i] = row.value[i];
+            result.min[i] = row.value[i];
+            result.max[i] = row.value[i];
+        }
+        return result;
+    }
+
+    void update(const Row<S> &row) {
+        for (size_t i = 0; i < S::values; ++i) {
+            min[i] = std::min(min[i], row.value[i]);
+            max[i] = std::max(max[i], row.value[i]);
+            sum[i] += row.value[i];
+        }
+        ++cnt;
+    }
+
+    void merge(const Record &other) {
+        cnt += other.cnt;
+        for (size_t i = 0; i < S::values; ++i) {
+            sum[i] += other.sum[i];
+            min[i] = std::min(min[i], other.min[i]);
+            max[i] = std::max(max[i], other.max[i]);
+        }
+    }
+
+    // "min/mean/max" per value column, separated by the schema delimiter. A
+    // single column with one decimal is the output of the challenge.
+    void format(std::ostream &out) const {
+        for (size_t i = 0; i < S::values; ++i) {
+            double scale = 1;
+            for (size_t d = 0; d < S::decimals[i]; ++d)
+                scale *= 10;
+            int64_t total = sum[i];
+            // Correct rounding
+            if (total > 0)
+                total += cnt / 2;
+            else
+                total -= cnt / 2;
+            if (i != 0)
+                out << S::delimiter;
+            out << std::setprecision(S::decimals[i]) << min[i] / scale << "/"
+                << (total / cnt) / scale << "/" << max[i] / scale;
+        }
+    }
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// A station table shared by all threads
+//
+// Same layout as the per-thread DB in 09_dynamic_chunks.cpp (65536 slots,
+// linear probing on the 16 bit hash), but the slots are claimed with a CAS
+// and the aggregates are atomics, so there are no per-thread tables and no
+// merge. The key of a slot is the pointer to the first occurrence of the name
+// in the mapped file packed together with the length into a single word:
+// user space pointers fit into 48 bits and names are below 64 KB, so one CAS
+// publishes both.
+//
+// With many threads hitting the same stations, the atomic updates of the hot
+// slots bounce between the cores. The aggregates can be striped: thread i
+// updates copy i % stripes, and the copies are combined on output.
+
+class SharedTable {
+  public:
+    explicit SharedTable(size_t stripes = 1)
+        : keys_(std::make_unique<std::atomic<uint64_t>[]>(slots)) {
+        for (size_t i = 0; i < stripes; ++i)
+            stripes_.push_back(std::make_unique<Stripe>());
+    }
+
+    void record(std::string_view name, uint16_t hash, int16_t value,
+                size_t stripe) {
+        size_t slot = claim_slot(name, hash);
+        AtomicRecord &rec = stripes_[stripe % stripes_.size()]->values[slot];
+
+        rec.cnt.fetch_add(1, std::memory_order_relaxed);
+        rec.sum.fetch_add(value, std::memory_order_relaxed);
+        // The min/max only change rarely once a station has a few rows, so
+        // the plain load avoids the read-modify-write most of the time.
+        int16_t min = rec.min.load(std::memory_order_relaxed);
+        while (value < min && not rec.min.compare_exchange_weak(
+                                  min, value, std::memory_order_relaxed))
+            ;
+        int16_t max = rec.max.load(std::memory_order_relaxed);
+        while (value > max && not rec.max.compare_exchange_weak(
+                                  max, value, std::memory_order_relaxed))
+            ;
+    }
+
+    // Call fn(name, cnt, sum, min, max) for every station, with the stripes
+    // combined. Only valid once all writers are done (e.g. joined).
+    template <typename Fn> void for_each(Fn &&fn) const {
+        for (size_t slot = 0; slot < slots; ++slot) {
+            uint64_t key = keys_[slot].load(std::memory_order_relaxed);
+            if (key == 0)
+                continue;
+            int64_t cnt = 0;
+            int64_t sum = 0;
+            int16_t min = INT16_MAX;
+            int16_t max = INT16_MIN;
+            for (auto &stripe : stripes_) {
+                auto &rec = stripe->values[slot];
+                cnt += rec.cnt.load(std::memory_order_relaxed);
+                sum += rec.sum.load(std::memory_order_relaxed);
+                min = std::min(min, rec.min.load(std::memory_order_relaxed));
+                max = std::max(max, rec.max.load(std::memory_order_relaxed));
+            }
+            fn(unpack(key), cnt, sum, min, max);
+        }
+    }
+
+  private:
+    static constexpr size_t slots = UINT16_MAX + 1;
+
+    struct AtomicRecord {
+        std::atomic<int64_t> cnt = 0;
+        std::atomic<int64_t> sum = 0;
+
+        std::atomic<int16_t> min = INT16_MAX;
+        std::atomic<int16_t> max = INT16_MIN;
+    };
+
+    struct Stripe {
+        AtomicRecord values[slots];
+    };
+
+    static uint64_t pack(std::string_view name) {
+        return uint64_t(reinterpret_cast<uintptr_t>(name.data())) << 16 |
+               name.size();
+    }
+
+    static std::string_view unpack(uint64_t key) {
+        return {reinterpret_cast<const char *>(key >> 16), key & 0xFFFF};
+    }
+
+    size_t claim_slot(std::string_view name, uint16_t hash) {
+        uint16_t slot = hash;
+
+        // While the slot is already occupied
+        uint64_t key = keys_[slot].load(std::memory_order_acquire);
+        while (true) {
+            if (key == 0) {
+                // Empty, try to claim it. On failure "key" is the name that
+                // won the race, which might be the same station.
+                if (keys_[slot].compare_exchange_strong(
+                        key, pack(name), std::memory_order_acq_rel,
+                        std::memory_order_acquire))
+                    return slot;
+                continue;
+            }
+            // If it is the same name, we have a hit
+            auto other = unpack(key);
+            if (other.size() == name.size() &&
+                memcmp(other.data(), name.data(), name.size()) == 0)
+                return slot;
+            // Otherwise we have a collision
+            key = keys_[++slot].load(std::memory_order_acquire);
+        }
+    }
+
+    std::unique_ptr<std::atomic<uint64_t>[]> keys_;
+    std::vector<std::unique_ptr<Stripe>> stripes_;
+};
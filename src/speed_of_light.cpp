@@ -0,0 +1,495 @@
+// Speed-of-light harness
+//
+// Measures how far the engine of 09_dynamic_chunks.cpp is from the limits of
+// the machine. Every stage reads the same file through a fresh mapping, with
+// the same dynamic chunks and thread count, and does a bit more work than the
+// previous one:
+//
+//   read    touch every byte (sum of 8 byte words), the read bandwidth bound
+//   memchr  find the newlines with memchr()
+//   scan    count the ';' and '\n' bytes with SIMD, no parsing
+//   engine  parse every line and update the per-thread tables, plus the merge
+//
+// Each stage runs with a warm page cache and, with --cache=cold, with the
+// file evicted from the page cache (POSIX_FADV_DONTNEED) before every run.
+// The throughput of a stage as a fraction of the read bound for the same
+// cache state shows where the time goes: a big drop from read to memchr/scan
+// is the scanning, from scan to engine the parsing and the hash table.
+//
+// Usage: speed_of_light [--input=measurements.txt] [--threads=1]
+//            [--chunk-mb=64] [--repeat=5] [--cache=warm,cold]
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <immintrin.h>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A move-only helper
+template <typename T, T empty = T{}> struct MoveOnly {
+    MoveOnly() : store_(empty) {}
+    MoveOnly(T value) : store_(value) {}
+    MoveOnly(MoveOnly &&other) : store_(std::exchange(other.store_, empty)) {}
+    MoveOnly &operator=(MoveOnly &&other) {
+        store_ = std::exchange(other.store_, empty);
+        return *this;
+    }
+    operator T() const { return store_; }
+    T get() const { return store_; }
+
+  private:
+    T store_;
+};
+
+struct FileFD {
+    FileFD(const std::filesystem::path &file_path)
+        : fd_(open(file_path.c_str(), O_RDONLY)) {
+        if (fd_ == -1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to open file");
+    }
+
+    ~FileFD() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    int get() const { return fd_.get(); }
+
+  private:
+    MoveOnly<int, -1> fd_;
+};
+
+struct MappedFile {
+    MappedFile(const std::filesystem::path &file_path,
+               size_t chunk_sz = 64 * 1024 * 1024) // 64MB
+        : fd_(file_path), chunk_sz_(chunk_sz) {
+        // Determine the filesize (needed for mmap)
+        struct stat sb;
+        if (fstat(fd_.get(), &sb) == 1)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to read file stats");
+        sz_ = sb.st_size;
+
+        begin_ = static_cast<char *>(
+            mmap(NULL, sz_, PROT_READ, MAP_PRIVATE, fd_.get(), 0));
+        if (begin_ == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(),
+                                    "Failed to map file to memory");
+        chunk_begin_ = begin_;
+    }
+
+    ~MappedFile() {
+        if (begin_ != nullptr)
+            munmap(begin_, sz_);
+    }
+
+    // The entire file content as a std::span
+    std::span<const char> data() const { return {begin_.get(), sz_.get()}; }
+
+    std::span<const char> next_chunk() {
+        std::lock_guard lock{mux_};
+        if (chunk_begin_ == begin_ + sz_)
+            return {};
+
+        const char *end = nullptr;
+        // prevent reading past the end of the file
+        if (chunk_begin_ + chunk_sz_ > begin_ + sz_) {
+            end = begin_ + sz_;
+        } else {
+            end = chunk_begin_ + chunk_sz_;
+            while (end != begin_ + sz_ && *end != '\n')
+                ++end;
+            if (end != begin_ + sz_)
+                ++end;
+        }
+        std::span<const char> result{chunk_begin_, end};
+        chunk_begin_ = end;
+        return result;
+    }
+
+  private:
+    FileFD fd_;
+    MoveOnly<char *> begin_;
+    MoveOnly<size_t> sz_;
+    size_t chunk_sz_;
+    const char *chunk_begin_;
+    std::mutex mux_;
+};
+
+
+// The engine of 09_dynamic_chunks.cpp
+struct Measurement {
+    std::string_view name;
+    uint16_t hash;
+    int16_t value;
+};
+
+struct Record {
+    int64_t cnt;
+    int64_t sum;
+
+    int16_t min;
+    int16_t max;
+};
+
+struct DB {
+    DB() : keys_{}, values_{}, filled_{} {}
+
+    void record(const Measurement &record) {
+        // Find the slot for this station
+        size_t slot = lookup_slot(record);
+
+        // If the slot is empty, we have a miss
+        if (keys_[slot].empty()) {
+            filled_.push_back(slot);
+            keys_[slot] = record.name;
+            values_[slot] = Record{1, record.value, record.value, record.value};
+            return;
+        }
+
+        // Otherwise we have a hit
+        if (record.value < values_[slot].min)
+            values_[slot].min = record.value;
+        else if (record.value > values_[slot].max)
+            values_[slot].max = record.value;
+        values_[slot].sum += record.value;
+        ++values_[slot].cnt;
+    }
+
+    size_t lookup_slot(const Measurement &record) const {
+        uint16_t slot = record.hash;
+
+        // While the slot is already occupied
+        while (not keys_[slot].empty()) {
+            // If it is the same name, we have a hit
+            if (keys_[slot] == record.name)
+                break;
+            // Otherwise we have a collision
+            ++slot;
+        }
+
+        // Either the first empty slot or a hit
+        return slot;
+    }
+
+    // Keys
+    std::array<std::string, UINT16_MAX + 1> keys_;
+    // Values
+    std::array<Record, UINT16_MAX + 1> values_;
+    // Record of used indices (needed for output)
+    std::vector<size_t> filled_;
+};
+
+consteval auto int_parse_table() {
+    std::array<std::array<int16_t, 2>, 256> data;
+    for (size_t c = 0; c < 256; ++c) {
+        if (c >= '0' && c <= '9') {
+            data[c][0] = c - '0';
+            data[c][1] = 10;
+        } else {
+            data[c][0] = 0;
+            data[c][1] = 1;
+        }
+    }
+    return data;
+}
+
+static constexpr auto params = int_parse_table();
+
+int16_t parse_int_table(std::span<const char>::iterator &iter) {
+    char sign = *iter;
+    int16_t result = 0;
+    while (*iter != '\n') {
+        result *= params[*iter][1];
+        result += params[*iter][0];
+        ++iter;
+    }
+    ++iter;
+    if (sign == '-')
+        return result * -1;
+    return result;
+}
+
+Measurement parse(std::span<const char>::iterator &iter) {
+    Measurement result;
+
+    const char *begin = iter.base();
+    result.hash = 0;
+    while (*iter != ';') {
+        result.hash = result.hash * 7 + *iter;
+        ++iter;
+    }
+    result.name = {begin, iter.base()};
+    ++iter;
+
+    result.value = parse_int_table(iter);
+
+    return result;
+}
+
+void process_input(DB &db, std::span<const char> data) {
+    auto iter = data.begin();
+
+    while (iter != data.end()) {
+        // Scan for the end of the station name
+        auto record = parse(iter);
+
+        db.record(record);
+    }
+}
+
+// Run "fn(chunk)" over the dynamic chunks in "threads" threads, returns the
+// sum of the results
+template <typename Fn>
+uint64_t run_chunks(MappedFile &file, size_t threads, Fn fn) {
+    std::vector<uint64_t> results(threads);
+    std::vector<std::jthread> runners(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        runners[i] = std::jthread([&, idx = i]() {
+            auto chunk = file.next_chunk();
+            while (not chunk.empty()) {
+                results[idx] += fn(idx, chunk);
+                chunk = file.next_chunk();
+            }
+        });
+    }
+    runners.clear(); // join threads
+    return std::accumulate(results.begin(), results.end(), uint64_t{0});
+}
+
+static uint64_t stage_read(MappedFile &file, size_t threads) {
+    return run_chunks(file, threads, [](size_t, std::span<const char> chunk) {
+        uint64_t sum = 0;
+        size_t i = 0;
+        for (; i + 8 <= chunk.size(); i += 8) {
+            uint64_t word;
+            memcpy(&word, chunk.data() + i, sizeof(word));
+            sum += word;
+        }
+        for (; i < chunk.size(); ++i)
+            sum += chunk[i];
+        return sum;
+    });
+}
+
+static uint64_t stage_memchr(MappedFile &file, size_t threads) {
+    return run_chunks(file, threads, [](size_t, std::span<const char> chunk) {
+        uint64_t lines = 0;
+        const char *ptr = chunk.data();
+        const char *end = chunk.data() + chunk.size();
+        while ((ptr = static_cast<const char *>(
+                    memchr(ptr, '\n', end - ptr))) != nullptr) {
+            ++lines;
+            ++ptr;
+        }
+        return lines;
+    });
+}
+
+static uint64_t stage_scan(MappedFile &file, size_t threads) {
+    return run_chunks(file, threads, [](size_t, std::span<const char> chunk) {
+        // SSE2 is part of the x86-64 baseline, 64 byte blocks as in
+        // 13_batch_parse.cpp
+        uint64_t semicolons = 0;
+        uint64_t newlines = 0;
+        size_t i = 0;
+        for (; i + 64 <= chunk.size(); i += 64) {
+            uint64_t semi = 0;
+            uint64_t nl = 0;
+            for (size_t j = 0; j < 4; ++j) {
+                __m128i block = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(chunk.data() + i) + j);
+                semi |= uint64_t(uint32_t(_mm_movemask_epi8(
+                            _mm_cmpeq_epi8(block, _mm_set1_epi8(';')))))
+                        << (j * 16);
+                nl |= uint64_t(uint32_t(_mm_movemask_epi8(
+                          _mm_cmpeq_epi8(block, _mm_set1_epi8('\n')))))
+                      << (j * 16);
+            }
+            semicolons += std::popcount(semi);
+            newlines += std::popcount(nl);
+        }
+        for (; i < chunk.size(); ++i) {
+            semicolons += chunk[i] == ';';
+            newlines += chunk[i] == '\n';
+        }
+        // Both counts have to be computed, only the lines are compared
+        return newlines + (semicolons != newlines) * (uint64_t{1} << 63);
+    });
+}
+
+static uint64_t stage_engine(MappedFile &file, size_t threads) {
+    std::vector<DB> dbs(threads);
+    run_chunks(file, threads, [&](size_t idx, std::span<const char> chunk) {
+        process_input(dbs[idx], chunk);
+        return 0;
+    });
+
+    // Merge the partial DBs
+    std::unordered_map<std::string, Record> merged;
+    for (auto &db_chunk : dbs) {
+        for (auto idx : db_chunk.filled_) {
+            auto it = merged.find(db_chunk.keys_[idx]);
+            if (it == merged.end()) {
+                merged.insert_or_assign(db_chunk.keys_[idx],
+                                        db_chunk.values_[idx]);
+            } else {
+                it->second.cnt += db_chunk.values_[idx].cnt;
+                it->second.sum += db_chunk.values_[idx].sum;
+                it->second.max =
+                    std::max(it->second.max, db_chunk.values_[idx].max);
+                it->second.min =
+                    std::min(it->second.min, db_chunk.values_[idx].min);
+            }
+        }
+    }
+    uint64_t lines = 0;
+    for (auto &[name, value] : merged)
+        lines += value.cnt;
+    return lines;
+}
+
+struct Stage {
+    std::string_view name;
+    uint64_t (*run)(MappedFile &, size_t);
+};
+
+static constexpr Stage stages[] = {
+    {"read", stage_read},
+    {"memchr", stage_memchr},
+    {"scan", stage_scan},
+    {"engine", stage_engine},
+};
+
+// Drop the file from the page cache. Only clean pages that aren't mapped
+// anywhere are evicted, so the previous mapping has to be gone by now.
+static void evict(const std::filesystem::path &path) {
+    FileFD fd(path);
+    if (fdatasync(fd.get()) == -1 ||
+        posix_fadvise(fd.get(), 0, 0, POSIX_FADV_DONTNEED) != 0)
+        throw std::system_error(errno, std::system_category(),
+                                "Failed to evict " + path.string());
+}
+
+struct Options {
+    std::filesystem::path input = "measurements.txt";
+    size_t threads = 1;
+    size_t chunk_mb = 64;
+    size_t repeat = 5;
+    std::vector<std::string> caches = {"warm"};
+};
+
+static Options parse_options(int argc, char **argv) {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = std::string(arg.substr(arg.find('=') + 1));
+        if (arg.starts_with("--input="))
+            opts.input = value;
+        else if (arg.starts_with("--threads="))
+            opts.threads = std::stoull(value);
+        else if (arg.starts_with("--chunk-mb="))
+            opts.chunk_mb = std::stoull(value);
+        else if (arg.starts_with("--repeat="))
+            opts.repeat = std::stoull(value);
+        else if (arg.starts_with("--cache=")) {
+            opts.caches.clear();
+            std::string_view list = value;
+            while (not list.empty()) {
+                auto pos = std::min(list.find(','), list.size());
+                opts.caches.emplace_back(list.substr(0, pos));
+                list.remove_prefix(std::min(pos + 1, list.size()));
+            }
+        } else
+            throw std::runtime_error("Unknown option " + std::string(arg));
+    }
+    for (auto &cache : opts.caches)
+        if (cache != "warm" && cache != "cold")
+            throw std::runtime_error("Unknown cache state " + cache);
+    return opts;
+}
+
+int main(int argc, char **argv) try {
+    Options opts = parse_options(argc, argv);
+    size_t bytes = std::filesystem::file_size(opts.input);
+    size_t chunk_sz = opts.chunk_mb * 1024 * 1024;
+
+    std::cout << opts.input.string() << ": " << bytes << " bytes, "
+              << opts.threads << " threads, " << opts.chunk_mb
+              << " MB chunks, median of " << opts.repeat << " runs\n\n";
+    std::cout << std::left << std::setw(8) << "stage" << std::setw(6)
+              << "cache" << std::right << std::setw(10) << "seconds"
+              << std::setw(8) << "GB/s" << std::setw(10) << "of bound"
+              << "\n";
+
+    for (auto &cache : opts.caches) {
+        bool cold = cache == "cold";
+        if (not cold) {
+            // Fault the whole file into the page cache once
+            MappedFile file(opts.input, chunk_sz);
+            stage_read(file, opts.threads);
+        }
+
+        double bound = 0;
+        std::optional<uint64_t> lines;
+        for (auto &stage : stages) {
+            std::vector<double> times;
+            for (size_t run = 0; run < opts.repeat; ++run) {
+                if (cold)
+                    evict(opts.input);
+                auto start = std::chrono::steady_clock::now();
+                MappedFile file(opts.input, chunk_sz);
+                uint64_t result = stage.run(file, opts.threads);
+                std::chrono::duration<double> elapsed =
+                    std::chrono::steady_clock::now() - start;
+                times.push_back(elapsed.count());
+
+                // The line counts of the later stages have to agree
+                if (stage.name != "read") {
+                    if (lines && *lines != result)
+                        throw std::runtime_error(
+                            "Line counts differ in stage " +
+                            std::string(stage.name));
+                    lines = result;
+                }
+            }
+            std::ranges::sort(times);
+            double median = times[times.size() / 2];
+            double gbps = bytes / median / 1e9;
+            if (stage.name == "read")
+                bound = gbps;
+            std::cout << std::left << std::setw(8) << stage.name
+                      << std::setw(6) << cache << std::right << std::fixed
+                      << std::setprecision(3) << std::setw(10) << median
+                      << std::setprecision(2) << std::setw(8) << gbps
+                      << std::setprecision(0) << std::setw(9)
+                      << 100 * gbps / bound << "%\n";
+        }
+    }
+} catch (const std::exception &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// The hash functions of the build-time perfect hash, shared by
+// gen_perfect_hash (which searches the displacements) and 15_perfect_hash
+// (which evaluates them).
+
+// FNV-1a, computed byte by byte while scanning for the ';'
+inline constexpr uint64_t station_hash_seed = 0xcbf29ce484222325;
+
+constexpr uint64_t station_hash_step(uint64_t hash, char c) {
+    return (hash ^ uint8_t(c)) * 0x100000001b3;
+}
+
+constexpr uint64_t station_hash(std::string_view name) {
+    uint64_t hash = station_hash_seed;
+    for (char c : name)
+        hash = station_hash_step(hash, c);
+    return hash;
+}
+
+// First level: the bucket of a name, from the high half of the hash
+constexpr size_t perfect_bucket(uint64_t hash, size_t buckets) {
+    return ((hash >> 32) * buckets) >> 32;
+}
+
+// Second level: the slot of a name given the displacement of its bucket
+constexpr size_t perfect_slot(uint64_t hash, uint32_t displacement,
+                              size_t slots) {
+    uint64_t x = hash + displacement * 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 29)) * 0xbf58476d1ce4e5b9;
+    x ^= x >> 32;
+    return (uint32_t(x) * uint64_t(slots)) >> 32;
+}